@@ -0,0 +1,178 @@
+//
+//  AppConfig.cpp
+//
+//
+
+#include "AppConfig.h"
+#include "ParticleConstants.h"
+
+//--------------------------------------------------------------
+AppConfig::AppConfig(){
+    /* Defaults, the ones that change the look are off so the program looks like it did before it had settings */
+    windowWidth = 960;
+    windowHeight = 720;
+    gridSize = 120;
+    cameras.assign(1, 0);
+    flowBackend = "farneback";
+    flowDecimate = 0.25;
+    flowSampling = "nearest";
+    motionIdleThreshold = 0;
+    motionLowResThreshold = 0;
+    flowDecay = 0.9;
+    capturePollMillis = 4;
+    pipelineDepth = 2;
+    recordFile = "";
+    replayFile = "";
+    repulsionRadius = 0;
+    repulsionStrength = 0.05;
+    tileSleepSpeed = 0;
+    tileWakeFlow = 0.1;
+    physicsSubsteps = 1;
+    physicsIntegrator = "euler";
+    springStiffness = ParticleConstants::springStiffness;
+    springNetworkStiffness = 0;
+    snapshotFile = "";
+    checkpointSeconds = 0;
+}
+
+//--------------------------------------------------------------
+bool AppConfig::load(string path){
+
+    /* No settings file is fine, we just keep the defaults */
+    if(!ofFile::doesFileExist(path))
+    {
+        ofLogNotice("AppConfig") << "No " << path << ", using the default settings";
+        return false;
+    }
+
+    ofBuffer buffer = ofBufferFromFile(path);
+    for(auto line : buffer.getLines()){
+
+        /* Strip comments and skip anything that isn't 'key = value' */
+        string text = line;
+        size_t comment = text.find('#');
+        if(comment != string::npos)
+        {
+            text = text.substr(0, comment);
+        }
+        size_t equals = text.find('=');
+        if(equals == string::npos)
+        {
+            continue;
+        }
+        string key = ofTrim(text.substr(0, equals));
+        string value = ofTrim(text.substr(equals + 1));
+
+        if(key == "windowWidth")
+        {
+            windowWidth = MAX(1, ofToInt(value));
+        }
+        else if(key == "windowHeight")
+        {
+            windowHeight = MAX(1, ofToInt(value));
+        }
+        else if(key == "gridSize")
+        {
+            gridSize = MAX(1, ofToInt(value));
+        }
+        else if(key == "cameras")
+        {
+            /* A comma separated list of device ids, like 0,1,2 */
+            vector<string> ids = ofSplitString(value, ",", true, true);
+            cameras.clear();
+            for(size_t i=0; i<ids.size(); i++){
+                cameras.push_back(ofToInt(ids[i]));
+            }
+            if(cameras.empty())
+            {
+                cameras.assign(1, 0);
+            }
+        }
+        else if(key == "flowBackend")
+        {
+            flowBackend = value;
+        }
+        else if(key == "flowDecimate")
+        {
+            flowDecimate = ofClamp(ofToFloat(value), 0.05, 1);
+        }
+        else if(key == "flowSampling")
+        {
+            flowSampling = value;
+        }
+        else if(key == "motionIdleThreshold")
+        {
+            motionIdleThreshold = ofToFloat(value);
+        }
+        else if(key == "motionLowResThreshold")
+        {
+            motionLowResThreshold = ofToFloat(value);
+        }
+        else if(key == "flowDecay")
+        {
+            flowDecay = ofToFloat(value);
+        }
+        else if(key == "capturePollMillis")
+        {
+            capturePollMillis = ofToInt(value);
+        }
+        else if(key == "pipelineDepth")
+        {
+            pipelineDepth = ofToInt(value);
+        }
+        else if(key == "recordFile")
+        {
+            recordFile = value;
+        }
+        else if(key == "replayFile")
+        {
+            replayFile = value;
+        }
+        else if(key == "repulsionRadius")
+        {
+            repulsionRadius = ofToFloat(value);
+        }
+        else if(key == "repulsionStrength")
+        {
+            repulsionStrength = ofToFloat(value);
+        }
+        else if(key == "tileSleepSpeed")
+        {
+            tileSleepSpeed = ofToFloat(value);
+        }
+        else if(key == "tileWakeFlow")
+        {
+            tileWakeFlow = ofToFloat(value);
+        }
+        else if(key == "physicsSubsteps")
+        {
+            physicsSubsteps = ofToInt(value);
+        }
+        else if(key == "physicsIntegrator")
+        {
+            physicsIntegrator = value;
+        }
+        else if(key == "springStiffness")
+        {
+            springStiffness = ofToFloat(value);
+        }
+        else if(key == "springNetworkStiffness")
+        {
+            springNetworkStiffness = ofToFloat(value);
+        }
+        else if(key == "snapshotFile")
+        {
+            snapshotFile = value;
+        }
+        else if(key == "checkpointSeconds")
+        {
+            checkpointSeconds = ofToFloat(value);
+        }
+        else
+        {
+            ofLogWarning("AppConfig") << "Unknown setting " << key;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,79 @@
+//
+//  AppConfig.h
+//
+//
+
+#ifndef AppConfig_h
+#define AppConfig_h
+
+/* Includes */
+#include "ofMain.h"
+
+/* Settings that change between installations, read once at startup from a text file in the
+ * data folder. Each line is 'key = value', anything after a '#' is a comment. Keys that are
+ * missing keep the default set in the constructor.
+*/
+
+class AppConfig{
+public:
+    /* Constructor, sets the defaults */
+    AppConfig();
+
+    /* Load the settings, returns false if the file could not be read */
+    bool load(string path);
+
+    /* The window, which can span several projectors, and how many particles across and down it */
+    int windowWidth, windowHeight, gridSize;
+
+    /* The webcams to use, by device id. Each one covers an equal strip of the window from the left */
+    vector<int> cameras;
+
+    /* Optical flow backend: farneback, dis_ultrafast, dis_fast, dis_medium or lk_grid */
+    string flowBackend;
+
+    /* How much smaller than the webcam the flow is, and how it is read at each particle: nearest
+     * or bilinear. Bilinear still looks smooth at a smaller decimate
+     */
+    float flowDecimate;
+    string flowSampling;
+
+    /* Motion gate, the mean pixel difference between frames (0-255) below which the flow is
+     * skipped or calculated at half size, and how fast the flow fades out while skipped
+     */
+    float motionIdleThreshold, motionLowResThreshold, flowDecay;
+
+    /* How often the camera is checked for a new frame, in milliseconds */
+    int capturePollMillis;
+
+    /* How many camera frames can wait for the flow, one means capture and flow take turns */
+    int pipelineDepth;
+
+    /* Record the flow to this file in the data folder, or play it back from one instead of the
+     * camera. Empty means don't
+     */
+    string recordFile, replayFile;
+
+    /* Free particles push each other apart inside this many pixels, zero turns it off */
+    float repulsionRadius, repulsionStrength;
+
+    /* Tiles of particles stop being updated once they are slower than sleepSpeed and start again
+     * when the flow under them is over wakeFlow. Zero speed turns it off
+     */
+    float tileSleepSpeed, tileWakeFlow;
+
+    /* Substeps per physics tick and the integrator: euler, position_verlet or velocity_verlet */
+    int physicsSubsteps;
+    string physicsIntegrator;
+
+    /* How hard the springs pull the particles back, negative. Stiffer springs need more substeps */
+    float springStiffness;
+
+    /* Springs between neighbouring particles like cloth, how hard they pull, negative. Zero turns it off */
+    float springNetworkStiffness;
+
+    /* Snapshot of the simulation in the data folder, loaded at startup and saved every checkpointSeconds, zero only saves with 's' */
+    string snapshotFile;
+    float checkpointSeconds;
+};
+
+#endif /* AppConfig_h */
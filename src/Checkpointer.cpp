@@ -0,0 +1,347 @@
+//
+//  Checkpointer.cpp
+//
+//
+
+#include "Checkpointer.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <cstring>
+
+/* Adds a whole vector to the list of sections */
+#define SNAPSHOT_SECTION(v) sections.push_back({(void*)v.data(), v.size() * sizeof(v[0])})
+
+//--------------------------------------------------------------
+Checkpointer::Checkpointer(){
+    intervalSeconds = 0;
+    lastCheckpoint = 0;
+    numCheckpoints = 0;
+    numSkipped = 0;
+    writing = false;
+    stopping = false;
+    lastWriteFailed = false;
+}
+
+//--------------------------------------------------------------
+Checkpointer::~Checkpointer(){
+    stop();
+}
+
+//--------------------------------------------------------------
+void Checkpointer::getSections(Simulation &sim, uint32_t numSpringEnds, vector<Section> &sections){
+    ParticleSystem &ps = sim.particles;
+    sections.clear();
+
+    /* The particles */
+    SNAPSHOT_SECTION(ps.posX);
+    SNAPSHOT_SECTION(ps.posY);
+    SNAPSHOT_SECTION(ps.velX);
+    SNAPSHOT_SECTION(ps.velY);
+    SNAPSHOT_SECTION(ps.frcX);
+    SNAPSHOT_SECTION(ps.frcY);
+    SNAPSHOT_SECTION(ps.originX);
+    SNAPSHOT_SECTION(ps.originY);
+    SNAPSHOT_SECTION(ps.lastPosX);
+    SNAPSHOT_SECTION(ps.lastPosY);
+    SNAPSHOT_SECTION(ps.prevX);
+    SNAPSHOT_SECTION(ps.prevY);
+    SNAPSHOT_SECTION(ps.life);
+    SNAPSHOT_SECTION(ps.maxLife);
+    SNAPSHOT_SECTION(ps.maxLifeOffset);
+    SNAPSHOT_SECTION(ps.flags);
+    SNAPSHOT_SECTION(ps.freeBits);
+    SNAPSHOT_SECTION(ps.returningBits);
+    SNAPSHOT_SECTION(ps.settlingBits);
+
+    /* Which tiles are asleep */
+    SNAPSHOT_SECTION(sim.tileAwake);
+    SNAPSHOT_SECTION(sim.tileQuietTicks);
+
+    /* Which springs of the network are torn, always last so it can be left out */
+    if(numSpringEnds > 0 && numSpringEnds == sim.network.state.size())
+    {
+        SNAPSHOT_SECTION(sim.network.state);
+    }
+}
+
+//--------------------------------------------------------------
+void Checkpointer::pack(Simulation &sim, vector<unsigned char> &buffer){
+
+    SimulationSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SIMULATION_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SIMULATION_SNAPSHOT_VERSION;
+    header.numParticles = sim.particles.size();
+    header.gridSize = sim.gridSize;
+    header.numSpringEnds = sim.network.state.size();
+    header.width = sim.particles.width;
+    header.height = sim.particles.height;
+    header.totalTicks = sim.clock.totalTicks;
+    header.resetParticles = sim.resetParticles;
+
+    vector<Section> sections;
+    getSections(sim, header.numSpringEnds, sections);
+    uint64_t offset = sizeof(header);
+    for(size_t s=0; s<sections.size(); s++){
+        offset = getSnapshotSectionOffset(offset) + sections[s].bytes;
+    }
+    header.fileBytes = offset;
+
+    /* The buffer keeps its memory between checkpoints, only the padding needs clearing */
+    buffer.resize(header.fileBytes);
+    memcpy(buffer.data(), &header, sizeof(header));
+    offset = sizeof(header);
+    for(size_t s=0; s<sections.size(); s++){
+        uint64_t start = getSnapshotSectionOffset(offset);
+        memset(buffer.data() + offset, 0, start - offset);
+        memcpy(buffer.data() + start, sections[s].data, sections[s].bytes);
+        offset = start + sections[s].bytes;
+    }
+}
+
+//--------------------------------------------------------------
+/* Write to a temporary file first, so a crash halfway through doesn't leave half a snapshot */
+bool Checkpointer::writeFile(const vector<unsigned char> &buffer, string path){
+    string tempPath = path + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if(file == NULL)
+    {
+        ofLogError("Checkpointer") << "Could not write " << tempPath;
+        return false;
+    }
+    size_t written = fwrite(buffer.data(), 1, buffer.size(), file);
+    bool closed = fclose(file) == 0;
+    if(written != buffer.size() || !closed)
+    {
+        ofLogError("Checkpointer") << "Could not write " << tempPath;
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    /* Renaming over a file replaces it in one go, except on Windows where it has to go first */
+    if(rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        remove(path.c_str());
+        if(rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            ofLogError("Checkpointer") << "Could not replace " << path;
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool Checkpointer::save(Simulation &sim, string path){
+    vector<unsigned char> buffer;
+    pack(sim, buffer);
+    return writeFile(buffer, path);
+}
+
+//--------------------------------------------------------------
+bool Checkpointer::load(Simulation &sim, string path){
+
+    MappedFile file;
+    if(!file.open(path))
+    {
+        ofLogNotice("Checkpointer") << "No snapshot at " << path << ", starting from the grid";
+        return false;
+    }
+
+    SimulationSnapshotHeader header;
+    if(file.getSize() < sizeof(header))
+    {
+        ofLogError("Checkpointer") << path << " is too short to be a snapshot";
+        return false;
+    }
+    memcpy(&header, file.getData(), sizeof(header));
+
+    if(memcmp(header.magic, SIMULATION_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SIMULATION_SNAPSHOT_VERSION)
+    {
+        ofLogError("Checkpointer") << path << " is not a snapshot this version can read";
+        return false;
+    }
+    if(header.fileBytes != file.getSize())
+    {
+        ofLogError("Checkpointer") << path << " was cut off while it was being written";
+        return false;
+    }
+
+    /* The particles are found by their index, so the grid has to be the same one */
+    if(header.numParticles != (uint32_t)sim.particles.size() || header.gridSize != (uint32_t)sim.gridSize ||
+       header.width != sim.particles.width || header.height != sim.particles.height)
+    {
+        ofLogError("Checkpointer") << path << " is from a " << header.gridSize << "x" << header.gridSize << " grid on a "
+                                   << header.width << "x" << header.height << " screen, it doesn't fit this one";
+        return false;
+    }
+
+    /* Check every array is in the file before touching anything */
+    vector<Section> sections;
+    getSections(sim, header.numSpringEnds, sections);
+    vector<uint64_t> offsets(sections.size());
+    uint64_t offset = sizeof(header);
+    for(size_t s=0; s<sections.size(); s++){
+        offsets[s] = getSnapshotSectionOffset(offset);
+        offset = offsets[s] + sections[s].bytes;
+    }
+    if(offset > file.getSize())
+    {
+        ofLogError("Checkpointer") << path << " is too short for this grid";
+        return false;
+    }
+
+    for(size_t s=0; s<sections.size(); s++){
+        memcpy(sections[s].data, file.getData() + offsets[s], sections[s].bytes);
+    }
+
+    /* The network left out of the file starts whole */
+    if(header.numSpringEnds != sim.network.state.size())
+    {
+        ofLogNotice("Checkpointer") << "The spring network has changed since " << path << " was saved, it starts whole";
+    }
+
+    sim.clock.totalTicks = header.totalTicks;
+    sim.resetParticles = header.resetParticles != 0;
+
+    /* The tiles that were asleep when it was saved would never wake up if sleeping is off now */
+    sim.setSleep(sim.sleepSpeed, sim.wakeFlow);
+    sim.awakeTileCount = 0;
+    for(size_t t=0; t<sim.tileAwake.size(); t++){
+        sim.awakeTileCount += sim.tileAwake[t] != 0;
+    }
+
+    ofLogNotice("Checkpointer") << "Loaded " << header.numParticles << " particles from " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+void Checkpointer::setup(string _path, float _intervalSeconds){
+    path = _path;
+    intervalSeconds = _intervalSeconds;
+    lastCheckpoint = ofGetElapsedTimef();
+
+    if(!writer.joinable())
+    {
+        stopping = false;
+        writer = std::thread([this]{ writerLoop(); });
+    }
+}
+
+//--------------------------------------------------------------
+/* The checkpoint being written is finished first */
+void Checkpointer::stop(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        wakeCondition.notify_one();
+    }
+    if(writer.joinable())
+    {
+        writer.join();
+    }
+}
+
+//--------------------------------------------------------------
+void Checkpointer::update(Simulation &sim){
+    if(intervalSeconds <= 0)
+    {
+        return;
+    }
+
+    double now = ofGetElapsedTimef();
+    if(now - lastCheckpoint >= intervalSeconds)
+    {
+        lastCheckpoint = now;
+        checkpoint(sim);
+    }
+}
+
+//--------------------------------------------------------------
+bool Checkpointer::checkpoint(Simulation &sim){
+    if(path.empty() || !writer.joinable())
+    {
+        return false;
+    }
+
+    /* The writer still has the buffer, rather skip this one than wait for the disk */
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(writing)
+        {
+            numSkipped++;
+            return false;
+        }
+    }
+
+    {
+        ProfileScope scope(Profiler::CHECKPOINT);
+        pack(sim, buffer);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    writing = true;
+    wakeCondition.notify_one();
+    return true;
+}
+
+//--------------------------------------------------------------
+/* For shutting down, waits for the checkpoint being written instead of skipping this one, then
+ * waits for this one too so the caller knows it is on disk
+ */
+bool Checkpointer::checkpointAndWait(Simulation &sim){
+    if(path.empty() || !writer.joinable())
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this]{ return !writing; });
+
+    /* The writer is idle and waits on the lock, so the buffer is ours */
+    {
+        ProfileScope scope(Profiler::CHECKPOINT);
+        pack(sim, buffer);
+    }
+    writing = true;
+    wakeCondition.notify_one();
+
+    doneCondition.wait(lock, [this]{ return !writing; });
+    return !lastWriteFailed;
+}
+
+//--------------------------------------------------------------
+void Checkpointer::writerLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+        wakeCondition.wait(lock, [this]{ return writing || stopping; });
+        if(writing)
+        {
+            /* The buffer is only touched by this thread until writing is false again */
+            lock.unlock();
+            bool written = writeFile(buffer, path);
+            lock.lock();
+            writing = false;
+            numCheckpoints += written;
+            lastWriteFailed = !written;
+            doneCondition.notify_all();
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+unsigned int Checkpointer::getNumCheckpoints(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return numCheckpoints;
+}
+
+//--------------------------------------------------------------
+unsigned int Checkpointer::getNumSkipped(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return numSkipped;
+}
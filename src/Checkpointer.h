@@ -0,0 +1,90 @@
+//
+//  Checkpointer.h
+//
+//
+
+#ifndef Checkpointer_h
+#define Checkpointer_h
+
+/* Includes */
+#include "ofMain.h"
+#include "Simulation.h"
+#include "SimulationSnapshot.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* Saves the whole simulation to a snapshot file and loads it back, see SimulationSnapshot.h for
+ * the format. Loading maps the file and copies each array out of it, which takes milliseconds
+ * even for a million particles, so a crashed installation is back where it was straight away.
+ *
+ * Checkpoints are taken every few seconds without holding up the frame. The main thread only
+ * copies the arrays into a buffer, which is a few memcpys, and a thread of its own writes the
+ * buffer to a temporary file and renames it over the last checkpoint. A crash while writing
+ * leaves the last good checkpoint where it was. If the disk is so slow that the last checkpoint
+ * is still being written, that one is skipped.
+*/
+
+class Checkpointer{
+public:
+    /* Constructor */
+    Checkpointer();
+    ~Checkpointer();
+
+    /* Write a snapshot of sim to path, or read one back into sim. The simulation has to be set
+     * up with the same grid first, and the sleep setting it has is kept. Both return false and
+     * leave sim alone if they can't
+     */
+    static bool save(Simulation &sim, string path);
+    static bool load(Simulation &sim, string path);
+
+    /* Save to path every intervalSeconds from update(), zero only saves when asked to */
+    void setup(string _path, float _intervalSeconds);
+    void stop();
+
+    /* Call once a frame from the main thread, takes a checkpoint once the interval is up */
+    void update(Simulation &sim);
+
+    /* Take a checkpoint now, returns false if the last one is still being written */
+    bool checkpoint(Simulation &sim);
+
+    /* Take a checkpoint now and wait until it is written, returns false if it couldn't be */
+    bool checkpointAndWait(Simulation &sim);
+
+    /* Getters */
+    unsigned int getNumCheckpoints();
+    unsigned int getNumSkipped();
+
+private:
+    /* One array in the file */
+    struct Section {
+        void *data;
+        size_t bytes;
+    };
+
+    /* Every array in a snapshot of sim in the order they are in the file, with the network's
+     * springs only if there are numSpringEnds of them
+     */
+    static void getSections(Simulation &sim, uint32_t numSpringEnds, vector<Section> &sections);
+
+    /* The header and the arrays in one buffer, laid out like the file */
+    static void pack(Simulation &sim, vector<unsigned char> &buffer);
+    static bool writeFile(const vector<unsigned char> &buffer, string path);
+
+    void writerLoop();
+
+    /* Variables */
+    string path;
+    float intervalSeconds;
+    double lastCheckpoint;
+    unsigned int numCheckpoints, numSkipped;
+
+    /* The buffer the writer thread writes, it belongs to the writer while writing is true */
+    vector<unsigned char> buffer;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wakeCondition, doneCondition;
+    bool writing, stopping, lastWriteFailed;
+};
+
+#endif /* Checkpointer_h */
@@ -0,0 +1,166 @@
+//
+//  FlowEstimator.cpp
+//
+//
+
+#include "FlowEstimator.h"
+
+//--------------------------------------------------------------
+FlowEstimator::FlowEstimator(){
+    lastMillis = 0;
+    averageMillis = 0;
+}
+
+//--------------------------------------------------------------
+void FlowEstimator::estimate(const Mat &current, const Mat &previous, Mat &flow){
+    uint64_t start = ofGetElapsedTimeMicros();
+
+    calc(current, previous, flow);
+
+    /* Keep the last time and a smoothed average so one slow frame doesn't throw it off */
+    float millis = (ofGetElapsedTimeMicros() - start) / 1000.0;
+    float average = averageMillis;
+    lastMillis = millis;
+    averageMillis = average == 0 ? millis : ofLerp(average, millis, 0.05);
+}
+
+//--------------------------------------------------------------
+float FlowEstimator::getLastMillis(){
+    return lastMillis;
+}
+
+//--------------------------------------------------------------
+float FlowEstimator::getAverageMillis(){
+    return averageMillis;
+}
+
+//--------------------------------------------------------------
+FlowEstimator* FlowEstimator::create(string name){
+#if CV_MAJOR_VERSION >= 4
+    if(name == "dis_ultrafast")
+    {
+        return new DisFlow(DISOpticalFlow::PRESET_ULTRAFAST);
+    }
+    else if(name == "dis_fast")
+    {
+        return new DisFlow(DISOpticalFlow::PRESET_FAST);
+    }
+    else if(name == "dis_medium")
+    {
+        return new DisFlow(DISOpticalFlow::PRESET_MEDIUM);
+    }
+#else
+    if(name.find("dis_") == 0)
+    {
+        ofLogWarning("FlowEstimator") << "DIS needs OpenCV 4, using Farneback instead";
+        return new FarnebackFlow();
+    }
+#endif
+    if(name == "lk_grid")
+    {
+        return new LkGridFlow(8);
+    }
+    else if(name != "farneback")
+    {
+        ofLogWarning("FlowEstimator") << "Unknown flow backend " << name << ", using Farneback instead";
+    }
+    return new FarnebackFlow();
+}
+
+//--------------------------------------------------------------
+void FarnebackFlow::calc(const Mat &current, const Mat &previous, Mat &flow){
+    //Computing optical flow (visit https://goo.gl/jm1Vfr for explanation of parameters)
+    calcOpticalFlowFarneback(current, previous, flow, 0.7, 3, 11, 5, 5, 1.1, 0);
+}
+
+//--------------------------------------------------------------
+string FarnebackFlow::getName(){
+    return "farneback";
+}
+
+#if CV_MAJOR_VERSION >= 4
+//--------------------------------------------------------------
+DisFlow::DisFlow(int _preset){
+    preset = _preset;
+    dis = DISOpticalFlow::create(preset);
+}
+
+//--------------------------------------------------------------
+void DisFlow::calc(const Mat &current, const Mat &previous, Mat &flow){
+    dis->calc(current, previous, flow);
+}
+
+//--------------------------------------------------------------
+string DisFlow::getName(){
+    if(preset == DISOpticalFlow::PRESET_ULTRAFAST)
+    {
+        return "dis_ultrafast";
+    }
+    else if(preset == DISOpticalFlow::PRESET_FAST)
+    {
+        return "dis_fast";
+    }
+    return "dis_medium";
+}
+#endif
+
+//--------------------------------------------------------------
+LkGridFlow::LkGridFlow(int _gridStep){
+    gridStep = _gridStep;
+    gridW = 0;
+    gridH = 0;
+}
+
+//--------------------------------------------------------------
+/* Place a point in the middle of every grid cell, these never move. When the image isn't a
+ * whole number of steps the cells are stretched a little to cover it, which is also how resize
+ * stretches the grid back over the image, so the points stay in the middle of the cells
+ */
+void LkGridFlow::setup(int width, int height){
+    gridW = MAX(1, width / gridStep);
+    gridH = MAX(1, height / gridStep);
+    float cellW = (float)width / gridW;
+    float cellH = (float)height / gridH;
+
+    points.clear();
+    for(int y=0; y<gridH; y++){
+        for(int x=0; x<gridW; x++){
+            points.push_back(Point2f((x + 0.5) * cellW, (y + 0.5) * cellH));
+        }
+    }
+    trackedPoints.resize(points.size());
+    status.resize(points.size());
+    error.resize(points.size());
+    gridFlow.create(gridH, gridW, CV_32FC2);
+}
+
+//--------------------------------------------------------------
+void LkGridFlow::calc(const Mat &current, const Mat &previous, Mat &flow){
+
+    /* Track the grid from the current frame into the previous one, same direction as Farneback */
+    calcOpticalFlowPyrLK(current, previous, points, trackedPoints, status, error, Size(15, 15), 2);
+
+    /* How far each point moved, points that were lost have no flow */
+    for(int y=0; y<gridH; y++){
+        Vec2f *row = gridFlow.ptr<Vec2f>(y);
+        for(int x=0; x<gridW; x++){
+            int i = y * gridW + x;
+            if(status[i])
+            {
+                row[x] = Vec2f(trackedPoints[i].x - points[i].x, trackedPoints[i].y - points[i].y);
+            }
+            else
+            {
+                row[x] = Vec2f(0, 0);
+            }
+        }
+    }
+
+    /* Stretch the grid over the whole image, the cell centres line up with the points */
+    resize(gridFlow, flow, flow.size(), 0, 0, INTER_LINEAR);
+}
+
+//--------------------------------------------------------------
+string LkGridFlow::getName(){
+    return "lk_grid";
+}
@@ -0,0 +1,101 @@
+//
+//  FlowEstimator.h
+//
+//
+
+/* -The different ways openCvThread can calculate the optical flow. They all take two
+ *  decimated grayscale frames and write a two channel float flow image, so they can be
+ *  swapped without changing anything else.
+ *
+ * -Farneback is what the program always used and looks the best. DIS is a lot cheaper and
+ *  the ultrafast preset keeps up on slow machines. The LK grid tracks a sparse grid of points
+ *  and stretches the result over the whole image, which is the cheapest of all.
+ *
+ * -Every estimator times itself so we can pick the right one for each venue.
+ */
+
+#pragma once
+
+/* Includes */
+#include "ofMain.h"
+#include "ofxOpenCV.h"
+#include <atomic>
+
+/* Set namespace to cv */
+using namespace cv;
+
+class FlowEstimator {
+
+public:
+
+    FlowEstimator();
+    virtual ~FlowEstimator() {}
+
+    /* Called once with the size of the frames before the first calc */
+    virtual void setup(int width, int height) {}
+
+    /* Flow from current to previous, flow is already allocated as CV_32FC2 */
+    virtual void calc(const Mat &current, const Mat &previous, Mat &flow) = 0;
+    virtual string getName() = 0;
+
+    /* Calls calc and times it, the times can be read from any thread */
+    void estimate(const Mat &current, const Mat &previous, Mat &flow);
+    float getLastMillis();
+    float getAverageMillis();
+
+    /* Makes an estimator from its name in the settings file, falls back to Farneback */
+    static FlowEstimator* create(string name);
+
+protected:
+
+    /* Written by the flow thread, read by the main thread for the overlay */
+    std::atomic<float> lastMillis, averageMillis;
+};
+
+//--------------------------------------------------------------
+/* Dense Farneback flow, the original settings */
+class FarnebackFlow : public FlowEstimator {
+
+public:
+
+    void calc(const Mat &current, const Mat &previous, Mat &flow);
+    string getName();
+};
+
+#if CV_MAJOR_VERSION >= 4
+//--------------------------------------------------------------
+/* Dense Inverse Search, part of OpenCV from version 4 */
+class DisFlow : public FlowEstimator {
+
+public:
+
+    DisFlow(int _preset);
+    void calc(const Mat &current, const Mat &previous, Mat &flow);
+    string getName();
+
+private:
+
+    int preset;
+    Ptr<DISOpticalFlow> dis;
+};
+#endif
+
+//--------------------------------------------------------------
+/* Pyramidal Lucas-Kanade on a regular grid of points, interpolated to a dense field */
+class LkGridFlow : public FlowEstimator {
+
+public:
+
+    LkGridFlow(int _gridStep);
+    void setup(int width, int height);
+    void calc(const Mat &current, const Mat &previous, Mat &flow);
+    string getName();
+
+private:
+
+    int gridStep, gridW, gridH;
+    vector<Point2f> points, trackedPoints;
+    vector<uchar> status;
+    vector<float> error;
+    Mat gridFlow;
+};
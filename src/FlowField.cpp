@@ -0,0 +1,270 @@
+//
+//  FlowField.cpp
+//
+//
+
+#include "FlowField.h"
+#include "Simd.h"
+
+//--------------------------------------------------------------
+/* One particle at a time, the same rounding as the AVX2 path. The sampling is a template
+ * parameter so each version is compiled without the test for the other one in its loop
+ */
+template<FlowField::Sampling SAMPLING>
+static void sampleScalar(const FlowField &field, const float *posX, const float *posY, int begin, int end, float *outX, float *outY, float gain){
+
+    const float *flowX = field.getX();
+    const float *flowY = field.getY();
+    int w = field.width;
+    int h = field.height;
+
+    for(int i=begin; i<end; i++){
+        if(SAMPLING == FlowField::NEAREST)
+        {
+            /* Convert the position to flow coordinates and clamp it so we never read outside the array */
+            int x = MAX(0, MIN((int)(posX[i] * field.scale), w - 1));
+            int y = MAX(0, MIN((int)(posY[i] * field.scale), h - 1));
+            int pos = y * w + x;
+            outX[i] = flowX[pos] * gain;
+            outY[i] = flowY[pos] * gain;
+        }
+        else
+        {
+            /* Pixel centres are at .5, so shift by half a pixel before finding the four around us */
+            float u = MAX(0.0f, MIN(posX[i] * field.scale - 0.5f, (float)(w - 1)));
+            float v = MAX(0.0f, MIN(posY[i] * field.scale - 0.5f, (float)(h - 1)));
+            int x0 = (int)u;
+            int y0 = (int)v;
+            int x1 = MIN(x0 + 1, w - 1);
+            int y1 = MIN(y0 + 1, h - 1);
+            float tx = u - x0;
+            float ty = v - y0;
+
+            int i00 = y0 * w + x0;
+            int i10 = y0 * w + x1;
+            int i01 = y1 * w + x0;
+            int i11 = y1 * w + x1;
+
+            float topX = flowX[i00] + (flowX[i10] - flowX[i00]) * tx;
+            float bottomX = flowX[i01] + (flowX[i11] - flowX[i01]) * tx;
+            float topY = flowY[i00] + (flowY[i10] - flowY[i00]) * tx;
+            float bottomY = flowY[i01] + (flowY[i11] - flowY[i01]) * tx;
+            outX[i] = (topX + (bottomX - topX) * ty) * gain;
+            outY[i] = (topY + (bottomY - topY) * ty) * gain;
+        }
+    }
+}
+
+#ifdef SIMD_X86
+
+//--------------------------------------------------------------
+/* 8 particles at a time, the flow pixels are fetched with gathers */
+template<FlowField::Sampling SAMPLING>
+SIMD_TARGET_AVX2
+static void sampleAvx2(const FlowField &field, const float *posX, const float *posY, int count, float *outX, float *outY, float gain){
+
+    const float *flowX = field.getX();
+    const float *flowY = field.getY();
+    int w = field.width;
+    int h = field.height;
+
+    const __m256 scale = _mm256_set1_ps(field.scale);
+    const __m256 gainV = _mm256_set1_ps(gain);
+    const __m256i zeroI = _mm256_setzero_si256();
+    const __m256i oneI = _mm256_set1_epi32(1);
+    const __m256i maxX = _mm256_set1_epi32(w - 1);
+    const __m256i maxY = _mm256_set1_epi32(h - 1);
+    const __m256i widthI = _mm256_set1_epi32(w);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 maxXf = _mm256_set1_ps((float)(w - 1));
+    const __m256 maxYf = _mm256_set1_ps((float)(h - 1));
+
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256 px = _mm256_mul_ps(_mm256_loadu_ps(posX + i), scale);
+        __m256 py = _mm256_mul_ps(_mm256_loadu_ps(posY + i), scale);
+
+        if(SAMPLING == FlowField::NEAREST)
+        {
+            /* Truncate like an (int) cast, then clamp */
+            __m256i x = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvttps_epi32(px), zeroI), maxX);
+            __m256i y = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvttps_epi32(py), zeroI), maxY);
+            __m256i pos = _mm256_add_epi32(_mm256_mullo_epi32(y, widthI), x);
+            _mm256_storeu_ps(outX + i, _mm256_mul_ps(_mm256_i32gather_ps(flowX, pos, 4), gainV));
+            _mm256_storeu_ps(outY + i, _mm256_mul_ps(_mm256_i32gather_ps(flowY, pos, 4), gainV));
+        }
+        else
+        {
+            __m256 u = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(px, half), zero), maxXf);
+            __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(py, half), zero), maxYf);
+            __m256i x0 = _mm256_cvttps_epi32(u);
+            __m256i y0 = _mm256_cvttps_epi32(v);
+            __m256i x1 = _mm256_min_epi32(_mm256_add_epi32(x0, oneI), maxX);
+            __m256i y1 = _mm256_min_epi32(_mm256_add_epi32(y0, oneI), maxY);
+            __m256 tx = _mm256_sub_ps(u, _mm256_cvtepi32_ps(x0));
+            __m256 ty = _mm256_sub_ps(v, _mm256_cvtepi32_ps(y0));
+
+            __m256i row0 = _mm256_mullo_epi32(y0, widthI);
+            __m256i row1 = _mm256_mullo_epi32(y1, widthI);
+            __m256i i00 = _mm256_add_epi32(row0, x0);
+            __m256i i10 = _mm256_add_epi32(row0, x1);
+            __m256i i01 = _mm256_add_epi32(row1, x0);
+            __m256i i11 = _mm256_add_epi32(row1, x1);
+
+            /* The same blend as the scalar path, in the same order so the results match */
+            __m256 a = _mm256_i32gather_ps(flowX, i00, 4);
+            __m256 b = _mm256_i32gather_ps(flowX, i10, 4);
+            __m256 c = _mm256_i32gather_ps(flowX, i01, 4);
+            __m256 d = _mm256_i32gather_ps(flowX, i11, 4);
+            __m256 top = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), tx));
+            __m256 bottom = _mm256_add_ps(c, _mm256_mul_ps(_mm256_sub_ps(d, c), tx));
+            _mm256_storeu_ps(outX + i, _mm256_mul_ps(_mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), ty)), gainV));
+
+            a = _mm256_i32gather_ps(flowY, i00, 4);
+            b = _mm256_i32gather_ps(flowY, i10, 4);
+            c = _mm256_i32gather_ps(flowY, i01, 4);
+            d = _mm256_i32gather_ps(flowY, i11, 4);
+            top = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), tx));
+            bottom = _mm256_add_ps(c, _mm256_mul_ps(_mm256_sub_ps(d, c), tx));
+            _mm256_storeu_ps(outY + i, _mm256_mul_ps(_mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), ty)), gainV));
+        }
+    }
+
+    /* Whatever is left over */
+    sampleScalar<SAMPLING>(field, posX, posY, i, count, outX, outY, gain);
+}
+
+#endif /* SIMD_X86 */
+
+//--------------------------------------------------------------
+FlowField::FlowField(){
+    width = 0;
+    height = 0;
+    scale = 1;
+    viewX = NULL;
+    viewY = NULL;
+}
+
+//--------------------------------------------------------------
+void FlowField::allocate(int _width, int _height, float _scale){
+    width = _width;
+    height = _height;
+    scale = _scale;
+    flowX.assign(width * height, 0);
+    flowY.assign(width * height, 0);
+    viewX = NULL;
+    viewY = NULL;
+}
+
+//--------------------------------------------------------------
+void FlowField::setView(const float *_viewX, const float *_viewY, int _width, int _height, float _scale){
+    width = _width;
+    height = _height;
+    scale = _scale;
+    viewX = _viewX;
+    viewY = _viewY;
+
+    /* Don't keep our own planes around if we aren't using them */
+    flowX.clear();
+    flowY.clear();
+}
+
+//--------------------------------------------------------------
+const float *FlowField::getX() const {
+    return viewX != NULL ? viewX : flowX.data();
+}
+
+//--------------------------------------------------------------
+const float *FlowField::getY() const {
+    return viewY != NULL ? viewY : flowY.data();
+}
+
+//--------------------------------------------------------------
+void FlowField::sample(const float *posX, const float *posY, int count, float *outX, float *outY, Sampling sampling,
+                       ParticleKernel::Backend backend, float gain) const {
+
+    /* Nothing to read from yet */
+    if(width <= 0 || height <= 0)
+    {
+        for(int i=0; i<count; i++){
+            outX[i] = 0;
+            outY[i] = 0;
+        }
+        return;
+    }
+
+#ifdef SIMD_X86
+    if(backend == ParticleKernel::AVX2)
+    {
+        if(sampling == NEAREST)
+        {
+            sampleAvx2<NEAREST>(*this, posX, posY, count, outX, outY, gain);
+        }
+        else
+        {
+            sampleAvx2<BILINEAR>(*this, posX, posY, count, outX, outY, gain);
+        }
+        return;
+    }
+#endif
+    if(sampling == NEAREST)
+    {
+        sampleScalar<NEAREST>(*this, posX, posY, 0, count, outX, outY, gain);
+    }
+    else
+    {
+        sampleScalar<BILINEAR>(*this, posX, posY, 0, count, outX, outY, gain);
+    }
+}
+
+//--------------------------------------------------------------
+void FlowField::getBlockMaxLengthSquared(int blockSize, vector<float> &out, int &blocksW, int &blocksH) const{
+    const float *flowX = getX();
+    const float *flowY = getY();
+    blocksW = (width + blockSize - 1) / blockSize;
+    blocksH = (height + blockSize - 1) / blockSize;
+    out.assign(blocksW * blocksH, 0);
+
+    /* One pass over the field in memory order. Each row of blocks first keeps the longest flow
+     * in every column, which is independent for every pixel so it vectorizes, then the columns
+     * are split into blocks
+     */
+    vector<float> columns(width);
+    for(int by=0; by<blocksH; by++){
+        std::fill(columns.begin(), columns.end(), 0.0f);
+        for(int y=by * blockSize; y<MIN((by + 1) * blockSize, height); y++){
+            const float *rowX = flowX + y * width;
+            const float *rowY = flowY + y * width;
+            for(int x=0; x<width; x++){
+                float lengthSquared = rowX[x] * rowX[x] + rowY[x] * rowY[x];
+                columns[x] = columns[x] > lengthSquared ? columns[x] : lengthSquared;
+            }
+        }
+
+        float *blocks = out.data() + by * blocksW;
+        for(int b=0; b<blocksW; b++){
+            for(int x=b * blockSize; x<MIN((b + 1) * blockSize, width); x++){
+                blocks[b] = MAX(blocks[b], columns[x]);
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+string FlowField::getSamplingName(Sampling sampling){
+    return sampling == BILINEAR ? "bilinear" : "nearest";
+}
+
+//--------------------------------------------------------------
+FlowField::Sampling FlowField::getSampling(string name){
+    if(name == "bilinear")
+    {
+        return BILINEAR;
+    }
+    else if(name != "nearest")
+    {
+        ofLogWarning("FlowField") << "Unknown flow sampling " << name << ", using nearest";
+    }
+    return NEAREST;
+}
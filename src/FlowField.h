@@ -0,0 +1,76 @@
+//
+//  FlowField.h
+//
+//
+
+#ifndef FlowField_h
+#define FlowField_h
+
+/* Includes */
+#include "ofMain.h"
+#include "ParticleKernel.h"
+
+/* One frame of optical flow, x and y in two separate float planes at the decimated size, and
+ * the scale that goes from screen coordinates to flow coordinates.
+ *
+ * sample() looks up the flow for a whole run of particles at once. Nearest is what the program
+ * always did. Bilinear blends the four flow pixels around a particle, so the force changes
+ * smoothly as a particle moves across the field instead of in steps, which means the flow can
+ * be calculated at a lower resolution without the particles looking blocky. When the kernel
+ * runs on AVX2 both read 8 particles at a time with gather instructions, any other backend
+ * reads them one at a time.
+ *
+ * Reads are fastest when particles next to each other in the arrays are next to each other on
+ * screen, which is why Simulation creates the particles in tiles.
+ *
+ * A field can also be a view of planes that live somewhere else, like a recording mapped into
+ * memory, in which case nothing is copied and flowX/flowY are empty.
+*/
+
+class FlowField{
+public:
+    /* How the flow is read between pixels */
+    enum Sampling {
+        NEAREST,
+        BILINEAR
+    };
+
+    /* Constructor */
+    FlowField();
+
+    /* Make both planes width by height and fill them with zero */
+    void allocate(int _width, int _height, float _scale);
+
+    /* Read the flow from someone else's memory, it has to stay valid while this field is used */
+    void setView(const float *_viewX, const float *_viewY, int _width, int _height, float _scale);
+
+    /* The planes, either our own or the ones we are a view of */
+    const float *getX() const;
+    const float *getY() const;
+
+    /* Read the flow at count positions in screen coordinates and write it times gain to outX/outY.
+     * Positions outside the field read the nearest edge. Pass the kernel's backend, so forcing
+     * the kernel to scalar does the same here
+     */
+    void sample(const float *posX, const float *posY, int count, float *outX, float *outY, Sampling sampling,
+                ParticleKernel::Backend backend, float gain = 1) const;
+
+    /* Split the field into blockSize by blockSize blocks and write the longest flow vector in
+     * each one, squared, to out. The blocks go row by row, blocksW of them to a row
+     */
+    void getBlockMaxLengthSquared(int blockSize, vector<float> &out, int &blocksW, int &blocksH) const;
+
+    /* Names used in the settings file */
+    static string getSamplingName(Sampling sampling);
+    static Sampling getSampling(string name);
+
+    /* Optical flow in x and y, width * height floats each */
+    vector<float> flowX, flowY;
+    int width, height;
+    float scale;
+
+    /* NULL unless this field is a view */
+    const float *viewX, *viewY;
+};
+
+#endif /* FlowField_h */
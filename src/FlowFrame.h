@@ -0,0 +1,36 @@
+//
+//  FlowFrame.h
+//
+//
+
+/* -Everything the optical flow thread hands over to the main thread for one camera frame.
+ *
+ * -The flow is stored at the decimated size in a FlowField, its scale is the decimate factor
+ *  so the main thread can go from screen coordinates to flow coordinates.
+ */
+
+#pragma once
+
+/* Includes */
+#include "ofMain.h"
+#include "FlowField.h"
+
+struct FlowFrame {
+
+    /* Optical flow in x and y */
+    FlowField field;
+
+    /* The mirrored webcam image at the same decimated size */
+    ofPixels image;
+
+    /* Counts up for every frame the thread publishes, zero means nothing has been published */
+    unsigned long long sequence;
+
+    /* When the camera frame arrived, in microseconds */
+    uint64_t timestamp;
+
+    FlowFrame() {
+        sequence = 0;
+        timestamp = 0;
+    }
+};
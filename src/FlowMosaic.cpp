@@ -0,0 +1,57 @@
+//
+//  FlowMosaic.cpp
+//
+//
+
+#include "FlowMosaic.h"
+#include <cstring>
+
+//--------------------------------------------------------------
+FlowMosaic::FlowMosaic(){
+    numTiles = 0;
+    tileW = 0;
+    tileH = 0;
+}
+
+//--------------------------------------------------------------
+void FlowMosaic::setup(int _numTiles, int _tileW, int _tileH, float scale){
+    numTiles = _numTiles;
+    tileW = _tileW;
+    tileH = _tileH;
+
+    /* Allocate once, the tiles are only ever copied in after this */
+    frame.field.allocate(numTiles * tileW, tileH, scale);
+    frame.image.allocate(numTiles * tileW, tileH, OF_PIXELS_RGB);
+    memset(frame.image.getData(), 0, frame.image.size());
+    frame.sequence = 0;
+    frame.timestamp = 0;
+}
+
+//--------------------------------------------------------------
+void FlowMosaic::setTile(int i, const FlowFrame &tile){
+
+    /* A camera that was set up at a different size would write over its neighbours */
+    if(i < 0 || i >= numTiles || tile.field.width != tileW || tile.field.height != tileH)
+    {
+        return;
+    }
+
+    /* Row by row into the strip, the flow planes and the image have the same layout */
+    int mosaicW = numTiles * tileW;
+    const float *tileX = tile.field.getX();
+    const float *tileY = tile.field.getY();
+    const unsigned char *tileImage = tile.image.getData();
+    unsigned char *image = frame.image.getData();
+    for(int y=0; y<tileH; y++){
+        memcpy(frame.field.flowX.data() + y * mosaicW + i * tileW, tileX + y * tileW, tileW * sizeof(float));
+        memcpy(frame.field.flowY.data() + y * mosaicW + i * tileW, tileY + y * tileW, tileW * sizeof(float));
+        if(tileImage != NULL)
+        {
+            memcpy(image + (y * mosaicW + i * tileW) * 3, tileImage + y * tileW * 3, tileW * 3);
+        }
+    }
+
+    /* The newest camera frame in the mosaic is the one the latency is measured from */
+    frame.sequence++;
+    frame.timestamp = MAX(frame.timestamp, tile.timestamp);
+}
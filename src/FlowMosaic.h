@@ -0,0 +1,42 @@
+//
+//  FlowMosaic.h
+//
+//
+
+#ifndef FlowMosaic_h
+#define FlowMosaic_h
+
+/* Includes */
+#include "ofMain.h"
+#include "FlowFrame.h"
+
+/* Puts the flow from several cameras side by side into one frame, for venues where the screen is
+ * wider than one camera can see. Camera i looks at the i-th strip of the screen from the left,
+ * and its flow and image are copied into that strip of the mosaic whenever it has a new frame.
+ *
+ * Each camera has its own capture and flow threads, so the flow keeps up however many cameras
+ * there are. The physics only ever sees one frame covering the whole screen, so a particle that
+ * gets pushed from one camera's strip into the next just reads the next camera's flow, and the
+ * particles are still split over every core by the worker pool.
+ *
+ * The frames are small, a 240x180 flow frame is under half a megabyte with its image, so copying
+ * them costs next to nothing compared to working out the flow.
+*/
+
+class FlowMosaic{
+public:
+    /* Constructor */
+    FlowMosaic();
+
+    /* numTiles frames of tileW by tileH flow pixels side by side, scale goes from screen to flow coordinates */
+    void setup(int _numTiles, int _tileW, int _tileH, float scale);
+
+    /* Copy camera i's newest frame into its strip */
+    void setTile(int i, const FlowFrame &tile);
+
+    /* The whole screen, its sequence counts up with every tile that changes */
+    FlowFrame frame;
+    int numTiles, tileW, tileH;
+};
+
+#endif /* FlowMosaic_h */
@@ -0,0 +1,170 @@
+//
+//  FlowPlayer.cpp
+//
+//
+
+#include "FlowPlayer.h"
+#include <cstring>
+
+//--------------------------------------------------------------
+FlowPlayer::FlowPlayer(){
+    width = 0;
+    height = 0;
+    scale = 1;
+    current = -1;
+    playhead = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+//--------------------------------------------------------------
+bool FlowPlayer::load(string path){
+
+    index.clear();
+    current = -1;
+    playhead = 0;
+
+    if(!file.open(path))
+    {
+        return false;
+    }
+
+    /* Check this is a recording we can read */
+    if(file.getSize() < sizeof(header))
+    {
+        ofLogError("FlowPlayer") << path << " is too small to be a recording";
+        file.close();
+        return false;
+    }
+    memcpy(&header, file.getData(), sizeof(header));
+    if(memcmp(header.magic, FLOW_RECORDING_MAGIC, sizeof(header.magic)) != 0 || header.version != FLOW_RECORDING_VERSION ||
+       header.frameBytes != getFlowRecordingFrameBytes(header.width, header.height, header.channels) || header.channels != 3)
+    {
+        ofLogError("FlowPlayer") << path << " is not a recording this version can read";
+        file.close();
+        return false;
+    }
+
+    /* The counts come from the file, so check them without anything that could wrap round */
+    uint64_t fileBytes = file.getSize();
+    if(header.frameBytes > fileBytes - sizeof(header))
+    {
+        ofLogError("FlowPlayer") << path << " has no frames";
+        file.close();
+        return false;
+    }
+
+    bool hasIndex = header.indexOffset >= sizeof(header) && header.numFrames <= fileBytes / sizeof(FlowRecordingIndex);
+    uint64_t indexBytes = hasIndex ? header.numFrames * sizeof(FlowRecordingIndex) : 0;
+    if(hasIndex && header.indexOffset <= fileBytes - indexBytes)
+    {
+        /* A complete recording, use its index */
+        index.resize(header.numFrames);
+        memcpy(index.data(), file.getData() + header.indexOffset, indexBytes);
+    }
+    else
+    {
+        /* The recording was never closed, every record is the same size so we can still find them */
+        uint64_t numFrames = (fileBytes - sizeof(header)) / header.frameBytes;
+        for(uint64_t i=0; i<numFrames; i++){
+            FlowRecordingIndex entry;
+            entry.offset = sizeof(header) + i * header.frameBytes;
+            FlowRecordingFrame frameHeader;
+            memcpy(&frameHeader, file.getData() + entry.offset, sizeof(frameHeader));
+            entry.timestamp = frameHeader.timestamp;
+            index.push_back(entry);
+        }
+        ofLogWarning("FlowPlayer") << path << " was not closed, found " << index.size() << " frames";
+    }
+
+    /* Every frame has to be inside the file */
+    for(size_t i=0; i<index.size(); i++){
+        if(index[i].offset < sizeof(header) || index[i].offset > fileBytes - header.frameBytes)
+        {
+            index.resize(i);
+            break;
+        }
+    }
+
+    if(index.empty())
+    {
+        ofLogError("FlowPlayer") << path << " has no frames";
+        file.close();
+        return false;
+    }
+
+    width = header.width;
+    height = header.height;
+    scale = header.scale;
+
+    ofLogNotice("FlowPlayer") << "Loaded " << index.size() << " " << width << "x" << height << " frames from " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+void FlowPlayer::getFrame(int i, FlowFrame &_frame){
+
+    /* The planes and the image sit one after the other behind the frame header */
+    unsigned char *record = file.getData() + index[i].offset;
+    FlowRecordingFrame frameHeader;
+    memcpy(&frameHeader, record, sizeof(frameHeader));
+
+    size_t numPixels = width * height;
+    const float *planeX = (const float*)(record + sizeof(FlowRecordingFrame));
+    const float *planeY = planeX + numPixels;
+    unsigned char *image = (unsigned char*)(planeY + numPixels);
+
+    _frame.field.setView(planeX, planeY, width, height, scale);
+    _frame.image.setFromExternalPixels(image, width, height, OF_PIXELS_RGB);
+    _frame.sequence = frameHeader.sequence;
+    _frame.timestamp = frameHeader.timestamp;
+}
+
+//--------------------------------------------------------------
+bool FlowPlayer::update(double elapsedSeconds){
+
+    if(index.empty())
+    {
+        return false;
+    }
+
+    /* Start on the first frame */
+    if(current < 0)
+    {
+        current = 0;
+        playhead = index[0].timestamp;
+        getFrame(current, frame);
+        return true;
+    }
+
+    playhead += (uint64_t)(MAX(elapsedSeconds, 0.0) * 1000000.0);
+
+    /* Loop back to the start once we are past the last frame */
+    int previous = current;
+    if(playhead > index.back().timestamp)
+    {
+        playhead = index[0].timestamp;
+        current = 0;
+    }
+
+    /* Skip to the newest frame that is due, just like the thread hands over the newest frame */
+    while(current + 1 < (int)index.size() && index[current + 1].timestamp <= playhead){
+        current++;
+    }
+
+    if(current != previous)
+    {
+        getFrame(current, frame);
+        return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+int FlowPlayer::getNumFrames(){
+    return index.size();
+}
+
+//--------------------------------------------------------------
+bool FlowPlayer::isLoaded(){
+    return file.isOpen();
+}
@@ -0,0 +1,55 @@
+//
+//  FlowPlayer.h
+//
+//
+
+#ifndef FlowPlayer_h
+#define FlowPlayer_h
+
+/* Includes */
+#include "ofMain.h"
+#include "FlowFrame.h"
+#include "FlowRecording.h"
+#include "MappedFile.h"
+
+/* Plays back a recording made by FlowRecorder instead of the camera, so an installation can be
+ * tuned or tested without anyone standing in front of it. The file is memory mapped and frames
+ * point straight into it, nothing is copied.
+ *
+ * update() plays it in real time and loops, for the app. getFrame() gets any frame straight
+ * away, the benchmark uses it to play the same frames in the same order as fast as it can.
+*/
+
+class FlowPlayer{
+public:
+    /* Constructor */
+    FlowPlayer();
+
+    /* Map a recording, returns false if it can't be read */
+    bool load(string path);
+
+    /* Point frame at recorded frame i, it stays valid as long as the player is loaded */
+    void getFrame(int i, FlowFrame &frame);
+
+    /* Move the playhead on, returns true if that moved it to a new frame */
+    bool update(double elapsedSeconds);
+
+    /* Getters */
+    int getNumFrames();
+    bool isLoaded();
+
+    /* The frame update() is on and the size of the recording */
+    FlowFrame frame;
+    int width, height;
+    float scale;
+
+private:
+    /* Variables */
+    MappedFile file;
+    FlowRecordingHeader header;
+    vector<FlowRecordingIndex> index;
+    int current;
+    uint64_t playhead;
+};
+
+#endif /* FlowPlayer_h */
@@ -0,0 +1,157 @@
+//
+//  FlowRecorder.cpp
+//
+//
+
+#include "FlowRecorder.h"
+#include <cstring>
+
+//--------------------------------------------------------------
+FlowRecorder::FlowRecorder(){
+    file = NULL;
+    nextOffset = 0;
+    firstTimestamp = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+//--------------------------------------------------------------
+FlowRecorder::~FlowRecorder(){
+    close();
+}
+
+//--------------------------------------------------------------
+bool FlowRecorder::open(string _path, int width, int height, float scale){
+    close();
+
+    path = _path;
+    file = fopen(path.c_str(), "wb");
+    if(file == NULL)
+    {
+        ofLogError("FlowRecorder") << "Could not write " << path;
+        return false;
+    }
+
+    /* The counts stay zero until close(), so a recording that was cut short can be spotted */
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLOW_RECORDING_MAGIC, sizeof(header.magic));
+    header.version = FLOW_RECORDING_VERSION;
+    header.width = width;
+    header.height = height;
+    header.scale = scale;
+    header.channels = 3;
+    uint64_t frameBytes = getFlowRecordingFrameBytes(width, height, header.channels);
+    if(frameBytes > UINT32_MAX)
+    {
+        ofLogError("FlowRecorder") << "A " << width << "x" << height << " flow is too big to record";
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+    header.frameBytes = frameBytes;
+    fwrite(&header, sizeof(header), 1, file);
+
+    nextOffset = sizeof(header);
+    index.clear();
+    padding.assign(64, 0);
+
+    ofLogNotice("FlowRecorder") << "Recording " << width << "x" << height << " flow to " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+void FlowRecorder::write(const FlowFrame &frame){
+
+    if(file == NULL)
+    {
+        return;
+    }
+
+    if(frame.field.width != (int)header.width || frame.field.height != (int)header.height)
+    {
+        ofLogWarning("FlowRecorder") << "Frame is the wrong size for this recording, skipping it";
+        return;
+    }
+
+    /* Timestamps start at zero with the first frame */
+    if(index.empty())
+    {
+        firstTimestamp = frame.timestamp;
+    }
+
+    FlowRecordingFrame frameHeader;
+    frameHeader.sequence = frame.sequence;
+    frameHeader.timestamp = frame.timestamp - firstTimestamp;
+
+    /* The header, both planes and the image, then zeros up to the record size. The padding comes
+     * from the sizes, not from what got written, so a short write can't make it run off the end
+     */
+    size_t numPixels = header.width * header.height;
+    size_t dataBytes = sizeof(frameHeader) + numPixels * (2 * sizeof(float) + header.channels);
+    struct Part {
+        const void *data;
+        size_t bytes;
+    };
+    Part parts[] = {
+        {&frameHeader, sizeof(frameHeader)},
+        {frame.field.getX(), numPixels * sizeof(float)},
+        {frame.field.getY(), numPixels * sizeof(float)},
+        {frame.image.getData(), numPixels * header.channels},
+        {padding.data(), header.frameBytes - dataBytes}
+    };
+
+    /* Stop at the first short write, the disk is full or gone */
+    for(const Part &part : parts){
+        if(fwrite(part.data, 1, part.bytes, file) != part.bytes)
+        {
+            ofLogError("FlowRecorder") << "Could not write to " << path << ", stopping the recording";
+            close();
+            return;
+        }
+    }
+
+    FlowRecordingIndex entry;
+    entry.offset = nextOffset;
+    entry.timestamp = frameHeader.timestamp;
+    index.push_back(entry);
+    nextOffset += header.frameBytes;
+}
+
+//--------------------------------------------------------------
+void FlowRecorder::close(){
+
+    if(file == NULL)
+    {
+        return;
+    }
+
+    /* The index goes after the last whole frame, over anything a failed write left behind, then the
+     * header is written again with the counts
+     */
+    header.numFrames = index.size();
+    header.indexOffset = nextOffset;
+#ifdef _WIN32
+    _fseeki64(file, nextOffset, SEEK_SET);
+#else
+    fseeko(file, nextOffset, SEEK_SET);
+#endif
+    if(!index.empty())
+    {
+        fwrite(index.data(), sizeof(FlowRecordingIndex), index.size(), file);
+    }
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    file = NULL;
+
+    ofLogNotice("FlowRecorder") << "Saved " << index.size() << " frames to " << path;
+}
+
+//--------------------------------------------------------------
+bool FlowRecorder::isOpen(){
+    return file != NULL;
+}
+
+//--------------------------------------------------------------
+int FlowRecorder::getNumFrames(){
+    return index.size();
+}
@@ -0,0 +1,47 @@
+//
+//  FlowRecorder.h
+//
+//
+
+#ifndef FlowRecorder_h
+#define FlowRecorder_h
+
+/* Includes */
+#include "ofMain.h"
+#include "FlowFrame.h"
+#include "FlowRecording.h"
+
+/* Appends flow frames to a recording file, see FlowRecording.h for the format. Only the thread
+ * that calls write() may use it, the optical flow thread records every frame it publishes.
+*/
+
+class FlowRecorder{
+public:
+    /* Constructor */
+    FlowRecorder();
+    ~FlowRecorder();
+
+    /* Start a new recording of width by height frames, returns false if the file can't be written */
+    bool open(string path, int width, int height, float scale);
+
+    /* Append one frame, it has to be the size the recording was opened with */
+    void write(const FlowFrame &frame);
+
+    /* Write the index and the frame count, the file is complete after this */
+    void close();
+
+    /* Getters */
+    bool isOpen();
+    int getNumFrames();
+
+private:
+    /* Variables */
+    FILE *file;
+    string path;
+    FlowRecordingHeader header;
+    vector<FlowRecordingIndex> index;
+    vector<unsigned char> padding;
+    uint64_t nextOffset, firstTimestamp;
+};
+
+#endif /* FlowRecorder_h */
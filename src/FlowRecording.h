@@ -0,0 +1,61 @@
+//
+//  FlowRecording.h
+//
+//
+
+/* -The file format FlowRecorder writes and FlowPlayer reads, a recording of what the optical
+ *  flow thread published so an installation can be replayed without a camera.
+ *
+ * -A 64 byte header, then one record per frame, then an index. Every record is the same size:
+ *  a 16 byte frame header, the x flow plane, the y flow plane and the decimated RGB image,
+ *  padded to a multiple of 64 bytes so the planes can be read straight out of a mapped file.
+ *
+ * -Frames are only ever appended. The index (offset and timestamp of every frame) and the
+ *  frame count in the header are written when the recording is closed. If the program died
+ *  before that, the frames can still be found because they are all the same size.
+ *
+ * -Everything is little endian, which is every machine we run on.
+ */
+
+#pragma once
+
+/* Includes */
+#include <cstdint>
+
+/* At the start of the file */
+struct FlowRecordingHeader {
+    char magic[8];          // "PSIFLOW1"
+    uint32_t version;
+    uint32_t width, height; // Size of the flow and the image
+    float scale;            // Screen to flow coordinates, the decimate
+    uint32_t channels;      // Channels in the image, always 3
+    uint32_t frameBytes;    // Size of one record including its padding
+    uint64_t numFrames;     // Zero until the recording is closed
+    uint64_t indexOffset;   // Zero until the recording is closed
+    char reserved[16];
+};
+static_assert(sizeof(FlowRecordingHeader) == 64, "The header must be 64 bytes");
+
+/* At the start of every record */
+struct FlowRecordingFrame {
+    uint64_t sequence;      // The sequence number the thread gave the frame
+    uint64_t timestamp;     // Microseconds since the recording started
+};
+static_assert(sizeof(FlowRecordingFrame) == 16, "The frame header must be 16 bytes");
+
+/* One entry of the index at the end of the file */
+struct FlowRecordingIndex {
+    uint64_t offset;
+    uint64_t timestamp;
+};
+
+#define FLOW_RECORDING_MAGIC "PSIFLOW1"
+#define FLOW_RECORDING_VERSION 1
+
+/* Size of one record for a width by height flow, in 64 bits so a broken header can't wrap it
+ * round to a size that matches
+ */
+inline uint64_t getFlowRecordingFrameBytes(uint32_t width, uint32_t height, uint32_t channels) {
+    uint64_t bytes = sizeof(FlowRecordingFrame) + (uint64_t)width * height * (2 * sizeof(float) + channels);
+    return (bytes + 63) & ~(uint64_t)63;
+}
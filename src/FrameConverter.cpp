@@ -0,0 +1,178 @@
+//
+//  FrameConverter.cpp
+//
+//
+
+#include "FrameConverter.h"
+#include "ParticleKernel.h"
+#include "Simd.h"
+
+/* OpenCV's RGB to gray weights, in 14 bit fixed point */
+static const int GRAY_R = 4899;
+static const int GRAY_G = 9617;
+static const int GRAY_B = 1868;
+static const int GRAY_SHIFT = 14;
+
+//--------------------------------------------------------------
+/* Where each of count output pixels starts and ends in size input pixels */
+static void makeBoxes(int size, int count, vector<int> &begin, vector<int> &end){
+    begin.resize(count);
+    end.resize(count);
+    for(int i=0; i<count; i++){
+        begin[i] = MIN(size - 1, (int)((long long)i * size / count));
+        end[i] = MAX(begin[i] + 1, (int)((long long)(i + 1) * size / count));
+    }
+}
+
+//--------------------------------------------------------------
+/* Add one camera row to the sums, or start them off with it */
+template<class T>
+static void addRowScalar(const unsigned char *row, int bytes, T *sum, bool first){
+    if(first)
+    {
+        for(int i=0; i<bytes; i++){
+            sum[i] = row[i];
+        }
+    }
+    else
+    {
+        for(int i=0; i<bytes; i++){
+            sum[i] += row[i];
+        }
+    }
+}
+
+#ifdef SIMD_X86
+
+//--------------------------------------------------------------
+/* 16 bytes at a time, widened to two sets of 8 sums */
+SIMD_TARGET_SSE
+static void addRowSse(const unsigned char *row, int bytes, uint16_t *sum, bool first){
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= bytes; i+=16){
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        if(!first)
+        {
+            low = _mm_add_epi16(low, _mm_loadu_si128((const __m128i*)(sum + i)));
+            high = _mm_add_epi16(high, _mm_loadu_si128((const __m128i*)(sum + i + 8)));
+        }
+        _mm_storeu_si128((__m128i*)(sum + i), low);
+        _mm_storeu_si128((__m128i*)(sum + i + 8), high);
+    }
+    addRowScalar(row + i, bytes - i, sum + i, first);
+}
+
+#endif
+
+//--------------------------------------------------------------
+/* Add up the columns under each output pixel of a row of sums and average them, written from the
+ * right so the image is mirrored
+ */
+template<class T>
+static void averageRow(const T *sum, int channels, int dstW, const int *colBegin, const int *colEnd, int boxH, unsigned char *colorRow, unsigned char *grayRow){
+    for(int x=0; x<dstW; x++){
+        unsigned int r = 0, g = 0, b = 0;
+        for(int c=colBegin[x]; c<colEnd[x]; c++){
+            const T *s = sum + c * channels;
+            r += s[0];
+            g += s[1];
+            b += s[2];
+        }
+
+        /* Average and round to the nearest, like OpenCV does */
+        float scale = 1.0f / ((colEnd[x] - colBegin[x]) * boxH);
+        r = r * scale + 0.5f;
+        g = g * scale + 0.5f;
+        b = b * scale + 0.5f;
+
+        int mirrored = dstW - 1 - x;
+        colorRow[mirrored * 3] = r;
+        colorRow[mirrored * 3 + 1] = g;
+        colorRow[mirrored * 3 + 2] = b;
+        grayRow[mirrored] = (r * GRAY_R + g * GRAY_G + b * GRAY_B + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+    }
+}
+
+//--------------------------------------------------------------
+FrameConverter::FrameConverter(){
+    srcW = 0;
+    srcH = 0;
+    dstW = 0;
+    dstH = 0;
+    wideSums = false;
+}
+
+//--------------------------------------------------------------
+void FrameConverter::setup(int _srcW, int _srcH, int _dstW, int _dstH){
+    srcW = _srcW;
+    srcH = _srcH;
+    dstW = _dstW;
+    dstH = _dstH;
+    makeBoxes(srcW, dstW, colBegin, colEnd);
+    makeBoxes(srcH, dstH, rowBegin, rowEnd);
+
+    /* 257 rows of 255 is the most 16 bits can add up, a taller box needs 32 bit sums */
+    int tallest = 0;
+    for(int y=0; y<dstH; y++){
+        tallest = MAX(tallest, rowEnd[y] - rowBegin[y]);
+    }
+    wideSums = tallest > 65535 / 255;
+    if(wideSums)
+    {
+        ofLogNotice("FrameConverter") << "The camera is " << tallest << " rows to one flow row, using the slower 32 bit sums";
+    }
+
+    /* Room for four channels, so the camera can be RGB or RGBA */
+    rowSum.assign(wideSums ? 0 : srcW * 4, 0);
+    wideRowSum.assign(wideSums ? srcW * 4 : 0, 0);
+}
+
+//--------------------------------------------------------------
+bool FrameConverter::isSetup(int _srcW, int _srcH, int _dstW, int _dstH){
+    return srcW == _srcW && srcH == _srcH && dstW == _dstW && dstH == _dstH;
+}
+
+//--------------------------------------------------------------
+void FrameConverter::convert(const unsigned char *src, int channels, unsigned char *color, int colorStride, unsigned char *gray, int grayStride){
+
+#ifdef SIMD_X86
+    /* Only ask the CPU once */
+    static const bool hasSse = ParticleKernel::getBestBackend() != ParticleKernel::SCALAR;
+#endif
+
+    int rowBytes = srcW * channels;
+
+    for(int y=0; y<dstH; y++){
+        unsigned char *colorRow = color + (size_t)y * colorStride;
+        unsigned char *grayRow = gray + (size_t)y * grayStride;
+        int boxH = rowEnd[y] - rowBegin[y];
+
+        /* Add up the camera rows under this output row, this is the only time they are read */
+        if(wideSums)
+        {
+            uint32_t *sum = wideRowSum.data();
+            for(int r=rowBegin[y]; r<rowEnd[y]; r++){
+                addRowScalar(src + (size_t)r * rowBytes, rowBytes, sum, r == rowBegin[y]);
+            }
+            averageRow(sum, channels, dstW, colBegin.data(), colEnd.data(), boxH, colorRow, grayRow);
+            continue;
+        }
+
+        uint16_t *sum = rowSum.data();
+        for(int r=rowBegin[y]; r<rowEnd[y]; r++){
+            const unsigned char *row = src + (size_t)r * rowBytes;
+#ifdef SIMD_X86
+            if(hasSse)
+            {
+                addRowSse(row, rowBytes, sum, r == rowBegin[y]);
+                continue;
+            }
+#endif
+            addRowScalar(row, rowBytes, sum, r == rowBegin[y]);
+        }
+        averageRow(sum, channels, dstW, colBegin.data(), colEnd.data(), boxH, colorRow, grayRow);
+    }
+}
@@ -0,0 +1,62 @@
+//
+//  FrameConverter.h
+//
+//
+
+#ifndef FrameConverter_h
+#define FrameConverter_h
+
+/* Includes */
+#include "ofMain.h"
+
+/* Turns a full size webcam frame into the small mirrored color and gray images the flow is
+ * calculated from, in one pass over the camera's pixels.
+ *
+ * Doing it with ofxOpenCv took a copy out of the grabber, a mirror, a resize and a gray
+ * conversion, which is four or five trips over a full size frame that is mostly thrown away.
+ * Here the camera's buffer is read once, in place. Each output row adds up the camera rows
+ * it covers into one row of sums, 16 bytes at a time with SSE, then each output pixel adds
+ * up the columns it covers from that row, which is small enough to stay in the cache. The
+ * pixel is written to the mirrored place in the color image and its gray value goes
+ * straight into the gray image.
+ *
+ * This is the same as an area resize (CV_INTER_AREA) when the camera is a whole number of
+ * times bigger than the flow, which it is at the default settings. Otherwise each output pixel
+ * averages the whole camera pixels it covers instead of weighting the ones on its edges. The
+ * gray value uses the same weights as OpenCV, from the averaged color. openCvThread checks it
+ * against OpenCV's mirror, resize and gray conversion every time it starts.
+*/
+
+class FrameConverter{
+public:
+    /* Constructor */
+    FrameConverter();
+
+    /* Camera frames of srcW by srcH go to images of dstW by dstH, only allocates when the size changes */
+    void setup(int _srcW, int _srcH, int _dstW, int _dstH);
+    bool isSetup(int _srcW, int _srcH, int _dstW, int _dstH);
+
+    /* src has channels bytes per pixel with the color in the first three, RGB order, rows packed
+     * one after another. color is RGB and gray one byte per pixel, each row starts stride bytes
+     * after the last
+     */
+    void convert(const unsigned char *src, int channels, unsigned char *color, int colorStride, unsigned char *gray, int grayStride);
+
+    int srcW, srcH, dstW, dstH;
+
+private:
+    /* The camera columns and rows each output pixel covers, output x covers columns colBegin[x]
+     * to colEnd[x]. There is always at least one, even if the camera is smaller than the output
+     */
+    vector<int> colBegin, colEnd, rowBegin, rowEnd;
+
+    /* One row of sums of the camera rows under an output row. 16 bits hold up to 257 rows of
+     * 255, which is every sensible setting. A camera more than 257 times taller than the flow
+     * uses 32 bit sums without SSE instead
+     */
+    vector<uint16_t> rowSum;
+    vector<uint32_t> wideRowSum;
+    bool wideSums;
+};
+
+#endif /* FrameConverter_h */
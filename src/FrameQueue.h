@@ -0,0 +1,132 @@
+//
+//  FrameQueue.h
+//
+//
+
+/* -A bounded queue of frames between two pipeline stages, one thread fills slots and the
+ *  other empties them in the same order.
+ *
+ * -The slots are allocated once before the threads start and then reused, nothing is ever
+ *  copied in or out. The producer asks for an empty slot, fills it in and pushes it, the
+ *  consumer takes the oldest full slot, uses it and pops it.
+ *
+ * -When every slot is full the producer waits, so a fast stage can only ever get depth frames
+ *  ahead of a slow one. A depth of one means the stages take turns.
+ *
+ * -Only one thread may push and only one thread may pop.
+ */
+
+#pragma once
+
+/* Includes */
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+template<class T>
+class FrameQueue {
+
+public:
+
+    /* The most slots a queue can have, they are all allocated whatever the depth */
+    enum { MAX_DEPTH = 8 };
+
+    //--------------------------------------------------------------
+    FrameQueue() {
+        depth = 2;
+        head = 0;
+        tail = 0;
+        interrupted = false;
+    }
+
+    //--------------------------------------------------------------
+    /* How many frames can wait in the queue, only call this before the threads have started */
+    void setDepth(int _depth) {
+        depth = _depth < 1 ? 1 : (_depth > MAX_DEPTH ? MAX_DEPTH : _depth);
+        head = 0;
+        tail = 0;
+        interrupted = false;
+    }
+
+    int getDepth() {
+        return depth;
+    }
+
+    //--------------------------------------------------------------
+    /* Access to the slots in use, only use this before the threads have started */
+    T& getSlot(int i) {
+        return slots[i];
+    }
+
+    //--------------------------------------------------------------
+    /* Producer, the next empty slot. Waits up to timeout for the consumer to free one and
+     * returns NULL if it didn't
+     */
+    T* acquire(int timeoutMillis) {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait_for(lock, std::chrono::milliseconds(timeoutMillis), [this]{ return interrupted || tail - head < (unsigned int)depth; });
+        if(interrupted || tail - head >= (unsigned int)depth)
+        {
+            return NULL;
+        }
+        return &slots[tail % depth];
+    }
+
+    //--------------------------------------------------------------
+    /* Producer, hand the slot from acquire() to the consumer */
+    void push() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tail++;
+        }
+        condition.notify_all();
+    }
+
+    //--------------------------------------------------------------
+    /* Consumer, the oldest full slot. Waits up to timeout for one and returns NULL if none came */
+    T* front(int timeoutMillis) {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait_for(lock, std::chrono::milliseconds(timeoutMillis), [this]{ return interrupted || head != tail; });
+        if(interrupted || head == tail)
+        {
+            return NULL;
+        }
+        return &slots[head % depth];
+    }
+
+    //--------------------------------------------------------------
+    /* Consumer, give the slot from front() back to the producer */
+    void pop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            head++;
+        }
+        condition.notify_all();
+    }
+
+    //--------------------------------------------------------------
+    /* How many full slots are waiting right now */
+    int size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tail - head;
+    }
+
+    //--------------------------------------------------------------
+    /* Wake both sides up for good, used when stopping the threads */
+    void interrupt() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            interrupted = true;
+        }
+        condition.notify_all();
+    }
+
+private:
+
+    T slots[MAX_DEPTH];
+    int depth;
+    unsigned int head, tail;
+    bool interrupted;
+    std::mutex mutex;
+    std::condition_variable condition;
+};
@@ -0,0 +1,123 @@
+//
+//  MappedFile.cpp
+//
+//
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------
+MappedFile::MappedFile(){
+    data = NULL;
+    size = 0;
+    fileHandle = NULL;
+    mappingHandle = NULL;
+    fd = -1;
+}
+
+//--------------------------------------------------------------
+MappedFile::~MappedFile(){
+    close();
+}
+
+//--------------------------------------------------------------
+bool MappedFile::open(string path){
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        ofLogError("MappedFile") << "Could not open " << path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if(mapping == NULL)
+    {
+        ofLogError("MappedFile") << "Could not map " << path;
+        CloseHandle(file);
+        return false;
+    }
+    data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = fileSize.QuadPart;
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        ofLogError("MappedFile") << "Could not open " << path;
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+    void *mapped = size > 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    data = mapped == MAP_FAILED ? NULL : (unsigned char*)mapped;
+#endif
+
+    if(data == NULL)
+    {
+        ofLogError("MappedFile") << "Could not map " << path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void MappedFile::close(){
+#ifdef _WIN32
+    if(data != NULL)
+    {
+        UnmapViewOfFile(data);
+    }
+    if(mappingHandle != NULL)
+    {
+        CloseHandle((HANDLE)mappingHandle);
+    }
+    if(fileHandle != NULL)
+    {
+        CloseHandle((HANDLE)fileHandle);
+    }
+#else
+    if(data != NULL)
+    {
+        munmap(data, size);
+    }
+    if(fd >= 0)
+    {
+        ::close(fd);
+    }
+#endif
+    data = NULL;
+    size = 0;
+    fileHandle = NULL;
+    mappingHandle = NULL;
+    fd = -1;
+}
+
+//--------------------------------------------------------------
+bool MappedFile::isOpen(){
+    return data != NULL;
+}
+
+//--------------------------------------------------------------
+unsigned char *MappedFile::getData(){
+    return data;
+}
+
+//--------------------------------------------------------------
+size_t MappedFile::getSize(){
+    return size;
+}
@@ -0,0 +1,47 @@
+//
+//  MappedFile.h
+//
+//
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+/* Includes */
+#include "ofMain.h"
+
+/* Maps a whole file into memory so it can be read like an array, the operating system pages it
+ * in as it is touched instead of us reading it all up front. The pages are copy-on-write, so
+ * writing through getData() never changes the file, which lets us hand the memory to things
+ * like ofPixels that want a non-const pointer.
+*/
+
+class MappedFile{
+public:
+    /* Constructor */
+    MappedFile();
+    ~MappedFile();
+
+    /* Only one owner, the mapping is released in the destructor */
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /* Map the file, returns false if it could not be opened */
+    bool open(string path);
+    void close();
+
+    /* Getters */
+    bool isOpen();
+    unsigned char *getData();
+    size_t getSize();
+
+private:
+    /* Variables */
+    unsigned char *data;
+    size_t size;
+
+    /* The file and mapping handles on Windows, the file descriptor everywhere else */
+    void *fileHandle, *mappingHandle;
+    int fd;
+};
+
+#endif /* MappedFile_h */
@@ -0,0 +1,50 @@
+//
+//  ParticleConstants.h
+//
+//
+
+#ifndef ParticleConstants_h
+#define ParticleConstants_h
+
+/* The numbers the physics was tuned with, which used to be literals spread over Particle, Spring,
+ * ParticleSystem and the kernels. The damping and flow numbers never change while the program
+ * runs, so the kernels use them as compile time constants. The spring numbers and gravity are
+ * only the defaults, they can be changed at runtime.
+*/
+
+struct ParticleConstants {
+    /* Taken off the force every step, times the velocity. Also used when bouncing off an edge */
+    static constexpr float damping = 0.01f;
+
+    /* The flow force, its length is clamped to cvMax, anything shorter than cvMin is ignored and
+     * the rest is scaled by cvGain times its length
+     */
+    static constexpr float cvMin = 0.1f;
+    static constexpr float cvMax = 0.3f;
+    static constexpr float cvGain = 0.1f;
+
+    /* The flow is reversed before it is turned into a force */
+    static constexpr float flowGain = -1.0f;
+
+    /* The spring network, shear and bend springs are this much as stiff as the structural ones.
+     * A network spring tears at breakRatio times its rest length and joins up again under
+     * joinRatio times
+     */
+    static constexpr float networkShear = 0.5f;
+    static constexpr float networkBend = 0.25f;
+    static constexpr float networkBreakRatio = 3.0f;
+    static constexpr float networkJoinRatio = 1.1f;
+
+    /* A sleeping tile in the network wakes up when the pull of the network, its origin spring and
+     * gravity on one of its particles adds up to more than this. A still grid is balanced, so only
+     * a change somewhere else, like a spring tearing, gets over it
+     */
+    static constexpr float networkWakeForce = 0.002f;
+
+    /* Defaults for the settings */
+    static constexpr float springStiffness = -0.01f;
+    static constexpr float springBreakLength = 125.0f;
+    static constexpr float gravity = 0.004f;
+};
+
+#endif /* ParticleConstants_h */
@@ -0,0 +1,715 @@
+//
+//  ParticleKernel.cpp
+//
+//
+
+#include "ParticleKernel.h"
+#include "Simd.h"
+#include "ParticleConstants.h"
+
+/* The flags every particle in a batch must have to take the vector path */
+static const unsigned char ATTACHED = ParticleSystem::DO_PHYSICS | ParticleSystem::DO_SPRING;
+
+//--------------------------------------------------------------
+/* Check that every particle in a batch is attached to its spring and has physics enabled */
+static bool allAttached(const unsigned char *flags, int count){
+    for(int k=0; k<count; k++){
+        if((flags[k] & ATTACHED) != ATTACHED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+/* The scalar path. Attached particles get exactly the steps the vector paths do, one at a time,
+ * everything else goes through ParticleSystem::step, which is what ofApp used to do for every
+ * particle. INTEGRATOR, SPRING and NEIGHBOURS are known at compile time, so the tests on them
+ * fold away
+ */
+template<ParticleSystem::Integrator INTEGRATOR, ParticleKernel::SpringModel SPRING, bool NEIGHBOURS>
+static void updateScalar(ParticleSystem &ps, int begin, int end, ofVec2f gravity){
+
+    const float h = ps.dt;
+    const float halfH = ps.dt * 0.5f;
+    const float stiffness = ps.springStiffness;
+    const float stiffRest = ps.springStiffness * ps.springLength;
+    const float breakLengthSquared = ps.springBreakLength * ps.springBreakLength;
+
+    for(int i=begin; i<end; i++){
+
+        if((ps.flags[i] & ATTACHED) != ATTACHED)
+        {
+            ps.step(i, gravity);
+            continue;
+        }
+
+        float px = ps.posX[i];
+        float py = ps.posY[i];
+        float vx = ps.velX[i];
+        float vy = ps.velY[i];
+
+        /* The Verlet schemes move the particle, or kick it with last step's force, first */
+        if(INTEGRATOR == ParticleSystem::POSITION_VERLET)
+        {
+            px += vx * halfH;
+            py += vy * halfH;
+        }
+        else if(INTEGRATOR == ParticleSystem::VELOCITY_VERLET)
+        {
+            vx += ps.frcX[i] * halfH;
+            vy += ps.frcY[i] * halfH;
+            px += vx * h;
+            py += vy * h;
+        }
+
+        /* Gravity and the optical flow force, clamp the length and ignore anything too small */
+        float fx = gravity.x;
+        float fy = gravity.y;
+        float cx = ps.cvForceX[i];
+        float cy = ps.cvForceY[i];
+        float cLen = MIN(sqrtf(cx * cx + cy * cy), ParticleConstants::cvMax);
+        if(cLen >= ParticleConstants::cvMin)
+        {
+            float cAmt = ParticleConstants::cvGain * cLen;
+            fx += cAmt * cx;
+            fy += cAmt * cy;
+        }
+
+        /* The spring network pulls on attached particles too */
+        if(NEIGHBOURS)
+        {
+            fx += ps.repelX[i];
+            fy += ps.repelY[i];
+        }
+
+        /* Dampen the force */
+        fx -= vx * ParticleConstants::damping;
+        fy -= vy * ParticleConstants::damping;
+
+        /* Spring force, see the SSE path for the maths */
+        float dx = px - ps.originX[i];
+        float dy = py - ps.originY[i];
+        float d2 = dx * dx + dy * dy;
+        if(SPRING == ParticleKernel::ZERO_LENGTH_SPRING)
+        {
+            fx += stiffness * dx;
+            fy += stiffness * dy;
+        }
+        else if(d2 > 0)
+        {
+            float k = stiffness - stiffRest / sqrtf(d2);
+            fx += dx * k;
+            fy += dy * k;
+        }
+        bool broken = d2 > breakLengthSquared;
+
+        /* Integrate */
+        if(INTEGRATOR == ParticleSystem::SEMI_IMPLICIT_EULER)
+        {
+            vx += fx * h;
+            vy += fy * h;
+            px += vx * h;
+            py += vy * h;
+        }
+        else if(INTEGRATOR == ParticleSystem::POSITION_VERLET)
+        {
+            vx += fx * h;
+            vy += fy * h;
+            px += vx * halfH;
+            py += vy * halfH;
+        }
+        else
+        {
+            vx += fx * halfH;
+            vy += fy * halfH;
+        }
+
+        ps.frcX[i] = fx;
+        ps.frcY[i] = fy;
+        ps.velX[i] = vx;
+        ps.velY[i] = vy;
+        ps.posX[i] = px;
+        ps.posY[i] = py;
+
+        /* Break the spring if it was stretched too far */
+        if(broken)
+        {
+            ps.flags[i] &= ~ParticleSystem::DO_SPRING;
+        }
+    }
+}
+
+#ifdef SIMD_X86
+
+//--------------------------------------------------------------
+/* 4 particles at a time using SSE */
+template<ParticleSystem::Integrator INTEGRATOR, ParticleKernel::SpringModel SPRING, bool NEIGHBOURS>
+SIMD_TARGET_SSE
+static void updateSse(ParticleSystem &ps, int begin, int end, ofVec2f gravity){
+
+    /* Pointers to the arrays we read and write */
+    float *posX = ps.posX.data();
+    float *posY = ps.posY.data();
+    float *velX = ps.velX.data();
+    float *velY = ps.velY.data();
+    float *frcX = ps.frcX.data();
+    float *frcY = ps.frcY.data();
+    const float *originX = ps.originX.data();
+    const float *originY = ps.originY.data();
+    const float *cvX = ps.cvForceX.data();
+    const float *cvY = ps.cvForceY.data();
+    const float *repelX = ps.repelX.data();
+    const float *repelY = ps.repelY.data();
+    unsigned char *flags = ps.flags.data();
+
+    /* Constants, the same values as the scalar functions use */
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 gravityX = _mm_set1_ps(gravity.x);
+    const __m128 gravityY = _mm_set1_ps(gravity.y);
+    const __m128 cvMin = _mm_set1_ps(ParticleConstants::cvMin);
+    const __m128 cvMax = _mm_set1_ps(ParticleConstants::cvMax);
+    const __m128 cvGain = _mm_set1_ps(ParticleConstants::cvGain);
+    const __m128 damping = _mm_set1_ps(ParticleConstants::damping);
+    const __m128 stiffness = _mm_set1_ps(ps.springStiffness);
+    const __m128 stiffRest = _mm_set1_ps(ps.springStiffness * ps.springLength);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+    const __m128 breakLengthSquared = _mm_set1_ps(ps.springBreakLength * ps.springBreakLength);
+    const __m128 h = _mm_set1_ps(ps.dt);
+    const __m128 halfH = _mm_set1_ps(ps.dt * 0.5f);
+
+    int i = begin;
+    for(; i + 4 <= end; i += 4){
+
+        /* Any free particles in this batch go through the scalar path */
+        if(!allAttached(flags + i, 4))
+        {
+            updateScalar<INTEGRATOR, SPRING, NEIGHBOURS>(ps, i, i + 4, gravity);
+            continue;
+        }
+
+        __m128 px = _mm_loadu_ps(posX + i);
+        __m128 py = _mm_loadu_ps(posY + i);
+        __m128 vx = _mm_loadu_ps(velX + i);
+        __m128 vy = _mm_loadu_ps(velY + i);
+
+        /* The Verlet schemes move the particle, or kick it with last step's force, first */
+        if(INTEGRATOR == ParticleSystem::POSITION_VERLET)
+        {
+            px = _mm_add_ps(px, _mm_mul_ps(vx, halfH));
+            py = _mm_add_ps(py, _mm_mul_ps(vy, halfH));
+        }
+        else if(INTEGRATOR == ParticleSystem::VELOCITY_VERLET)
+        {
+            vx = _mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(frcX + i), halfH));
+            vy = _mm_add_ps(vy, _mm_mul_ps(_mm_loadu_ps(frcY + i), halfH));
+            px = _mm_add_ps(px, _mm_mul_ps(vx, h));
+            py = _mm_add_ps(py, _mm_mul_ps(vy, h));
+        }
+
+        /* Reset the force and add gravity */
+        __m128 fx = gravityX;
+        __m128 fy = gravityY;
+
+        /* Optical flow force, clamp the length and ignore anything too small */
+        __m128 cx = _mm_loadu_ps(cvX + i);
+        __m128 cy = _mm_loadu_ps(cvY + i);
+        __m128 cLen = _mm_min_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy))), cvMax);
+        __m128 cAmt = _mm_and_ps(_mm_cmpge_ps(cLen, cvMin), _mm_mul_ps(cvGain, cLen));
+        fx = _mm_add_ps(fx, _mm_mul_ps(cAmt, cx));
+        fy = _mm_add_ps(fy, _mm_mul_ps(cAmt, cy));
+
+        /* The spring network pulls on attached particles too */
+        if(NEIGHBOURS)
+        {
+            fx = _mm_add_ps(fx, _mm_loadu_ps(repelX + i));
+            fy = _mm_add_ps(fy, _mm_loadu_ps(repelY + i));
+        }
+
+        /* Dampen the force */
+        fx = _mm_sub_ps(fx, _mm_mul_ps(vx, damping));
+        fy = _mm_sub_ps(fy, _mm_mul_ps(vy, damping));
+
+        /* Spring force. The stretch along the spring is (d - rest) * dx / d, which is the same as
+         * (1 - rest / d) * dx, so the direction and the length come out of one reciprocal square
+         * root. The estimate is good to 12 bits, one Newton step takes it to nearly full float.
+         * Without a rest length the force is just the stiffness times the stretch and no root is
+         * needed at all. A zero length vector gives no force, just like normalize()
+         */
+        __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(originX + i));
+        __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(originY + i));
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        if(SPRING == ParticleKernel::ZERO_LENGTH_SPRING)
+        {
+            fx = _mm_add_ps(fx, _mm_mul_ps(stiffness, dx));
+            fy = _mm_add_ps(fy, _mm_mul_ps(stiffness, dy));
+        }
+        else
+        {
+            __m128 r = _mm_rsqrt_ps(d2);
+            r = _mm_mul_ps(r, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, d2), _mm_mul_ps(r, r))));
+            __m128 k = _mm_sub_ps(stiffness, _mm_mul_ps(stiffRest, r));
+            k = _mm_and_ps(_mm_cmpgt_ps(d2, zero), k);
+            fx = _mm_add_ps(fx, _mm_mul_ps(dx, k));
+            fy = _mm_add_ps(fy, _mm_mul_ps(dy, k));
+        }
+
+        /* Compare squared lengths so the break test needs no root either */
+        int breakMask = _mm_movemask_ps(_mm_cmpgt_ps(d2, breakLengthSquared));
+
+        /* Integrate */
+        if(INTEGRATOR == ParticleSystem::SEMI_IMPLICIT_EULER)
+        {
+            vx = _mm_add_ps(vx, _mm_mul_ps(fx, h));
+            vy = _mm_add_ps(vy, _mm_mul_ps(fy, h));
+            px = _mm_add_ps(px, _mm_mul_ps(vx, h));
+            py = _mm_add_ps(py, _mm_mul_ps(vy, h));
+        }
+        else if(INTEGRATOR == ParticleSystem::POSITION_VERLET)
+        {
+            vx = _mm_add_ps(vx, _mm_mul_ps(fx, h));
+            vy = _mm_add_ps(vy, _mm_mul_ps(fy, h));
+            px = _mm_add_ps(px, _mm_mul_ps(vx, halfH));
+            py = _mm_add_ps(py, _mm_mul_ps(vy, halfH));
+        }
+        else
+        {
+            vx = _mm_add_ps(vx, _mm_mul_ps(fx, halfH));
+            vy = _mm_add_ps(vy, _mm_mul_ps(fy, halfH));
+        }
+
+        _mm_storeu_ps(frcX + i, fx);
+        _mm_storeu_ps(frcY + i, fy);
+        _mm_storeu_ps(velX + i, vx);
+        _mm_storeu_ps(velY + i, vy);
+        _mm_storeu_ps(posX + i, px);
+        _mm_storeu_ps(posY + i, py);
+
+        /* Break any springs that were stretched too far */
+        if(breakMask)
+        {
+            for(int b=0; b<4; b++){
+                if(breakMask & (1 << b))
+                {
+                    flags[i + b] &= ~ParticleSystem::DO_SPRING;
+                }
+            }
+        }
+    }
+
+    /* Whatever is left over */
+    updateScalar<INTEGRATOR, SPRING, NEIGHBOURS>(ps, i, end, gravity);
+}
+
+//--------------------------------------------------------------
+/* 8 particles at a time using AVX2 */
+template<ParticleSystem::Integrator INTEGRATOR, ParticleKernel::SpringModel SPRING, bool NEIGHBOURS>
+SIMD_TARGET_AVX2
+static void updateAvx2(ParticleSystem &ps, int begin, int end, ofVec2f gravity){
+
+    /* Pointers to the arrays we read and write */
+    float *posX = ps.posX.data();
+    float *posY = ps.posY.data();
+    float *velX = ps.velX.data();
+    float *velY = ps.velY.data();
+    float *frcX = ps.frcX.data();
+    float *frcY = ps.frcY.data();
+    const float *originX = ps.originX.data();
+    const float *originY = ps.originY.data();
+    const float *cvX = ps.cvForceX.data();
+    const float *cvY = ps.cvForceY.data();
+    const float *repelX = ps.repelX.data();
+    const float *repelY = ps.repelY.data();
+    unsigned char *flags = ps.flags.data();
+
+    /* Constants, the same values as the scalar functions use */
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 gravityX = _mm256_set1_ps(gravity.x);
+    const __m256 gravityY = _mm256_set1_ps(gravity.y);
+    const __m256 cvMin = _mm256_set1_ps(ParticleConstants::cvMin);
+    const __m256 cvMax = _mm256_set1_ps(ParticleConstants::cvMax);
+    const __m256 cvGain = _mm256_set1_ps(ParticleConstants::cvGain);
+    const __m256 damping = _mm256_set1_ps(ParticleConstants::damping);
+    const __m256 stiffness = _mm256_set1_ps(ps.springStiffness);
+    const __m256 stiffRest = _mm256_set1_ps(ps.springStiffness * ps.springLength);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+    const __m256 breakLengthSquared = _mm256_set1_ps(ps.springBreakLength * ps.springBreakLength);
+    const __m256 h = _mm256_set1_ps(ps.dt);
+    const __m256 halfH = _mm256_set1_ps(ps.dt * 0.5f);
+
+    int i = begin;
+    for(; i + 8 <= end; i += 8){
+
+        /* Any free particles in this batch go through the scalar path */
+        if(!allAttached(flags + i, 8))
+        {
+            updateScalar<INTEGRATOR, SPRING, NEIGHBOURS>(ps, i, i + 8, gravity);
+            continue;
+        }
+
+        __m256 px = _mm256_loadu_ps(posX + i);
+        __m256 py = _mm256_loadu_ps(posY + i);
+        __m256 vx = _mm256_loadu_ps(velX + i);
+        __m256 vy = _mm256_loadu_ps(velY + i);
+
+        /* The Verlet schemes move the particle, or kick it with last step's force, first */
+        if(INTEGRATOR == ParticleSystem::POSITION_VERLET)
+        {
+            px = _mm256_add_ps(px, _mm256_mul_ps(vx, halfH));
+            py = _mm256_add_ps(py, _mm256_mul_ps(vy, halfH));
+        }
+        else if(INTEGRATOR == ParticleSystem::VELOCITY_VERLET)
+        {
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_loadu_ps(frcX + i), halfH));
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_loadu_ps(frcY + i), halfH));
+            px = _mm256_add_ps(px, _mm256_mul_ps(vx, h));
+            py = _mm256_add_ps(py, _mm256_mul_ps(vy, h));
+        }
+
+        /* Reset the force and add gravity */
+        __m256 fx = gravityX;
+        __m256 fy = gravityY;
+
+        /* Optical flow force, clamp the length and ignore anything too small */
+        __m256 cx = _mm256_loadu_ps(cvX + i);
+        __m256 cy = _mm256_loadu_ps(cvY + i);
+        __m256 cLen = _mm256_min_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy))), cvMax);
+        __m256 cAmt = _mm256_and_ps(_mm256_cmp_ps(cLen, cvMin, _CMP_GE_OQ), _mm256_mul_ps(cvGain, cLen));
+        fx = _mm256_add_ps(fx, _mm256_mul_ps(cAmt, cx));
+        fy = _mm256_add_ps(fy, _mm256_mul_ps(cAmt, cy));
+
+        /* The spring network pulls on attached particles too */
+        if(NEIGHBOURS)
+        {
+            fx = _mm256_add_ps(fx, _mm256_loadu_ps(repelX + i));
+            fy = _mm256_add_ps(fy, _mm256_loadu_ps(repelY + i));
+        }
+
+        /* Dampen the force */
+        fx = _mm256_sub_ps(fx, _mm256_mul_ps(vx, damping));
+        fy = _mm256_sub_ps(fy, _mm256_mul_ps(vy, damping));
+
+        /* Spring force, the same maths as the SSE path */
+        __m256 dx = _mm256_sub_ps(px, _mm256_loadu_ps(originX + i));
+        __m256 dy = _mm256_sub_ps(py, _mm256_loadu_ps(originY + i));
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        if(SPRING == ParticleKernel::ZERO_LENGTH_SPRING)
+        {
+            fx = _mm256_add_ps(fx, _mm256_mul_ps(stiffness, dx));
+            fy = _mm256_add_ps(fy, _mm256_mul_ps(stiffness, dy));
+        }
+        else
+        {
+            __m256 r = _mm256_rsqrt_ps(d2);
+            r = _mm256_mul_ps(r, _mm256_sub_ps(threeHalves, _mm256_mul_ps(_mm256_mul_ps(half, d2), _mm256_mul_ps(r, r))));
+            __m256 k = _mm256_sub_ps(stiffness, _mm256_mul_ps(stiffRest, r));
+            k = _mm256_and_ps(_mm256_cmp_ps(d2, zero, _CMP_GT_OQ), k);
+            fx = _mm256_add_ps(fx, _mm256_mul_ps(dx, k));
+            fy = _mm256_add_ps(fy, _mm256_mul_ps(dy, k));
+        }
+        int breakMask = _mm256_movemask_ps(_mm256_cmp_ps(d2, breakLengthSquared, _CMP_GT_OQ));
+
+        /* Integrate */
+        if(INTEGRATOR == ParticleSystem::SEMI_IMPLICIT_EULER)
+        {
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(fx, h));
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(fy, h));
+            px = _mm256_add_ps(px, _mm256_mul_ps(vx, h));
+            py = _mm256_add_ps(py, _mm256_mul_ps(vy, h));
+        }
+        else if(INTEGRATOR == ParticleSystem::POSITION_VERLET)
+        {
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(fx, h));
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(fy, h));
+            px = _mm256_add_ps(px, _mm256_mul_ps(vx, halfH));
+            py = _mm256_add_ps(py, _mm256_mul_ps(vy, halfH));
+        }
+        else
+        {
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(fx, halfH));
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(fy, halfH));
+        }
+
+        _mm256_storeu_ps(frcX + i, fx);
+        _mm256_storeu_ps(frcY + i, fy);
+        _mm256_storeu_ps(velX + i, vx);
+        _mm256_storeu_ps(velY + i, vy);
+        _mm256_storeu_ps(posX + i, px);
+        _mm256_storeu_ps(posY + i, py);
+
+        /* Break any springs that were stretched too far */
+        if(breakMask)
+        {
+            for(int b=0; b<8; b++){
+                if(breakMask & (1 << b))
+                {
+                    flags[i + b] &= ~ParticleSystem::DO_SPRING;
+                }
+            }
+        }
+    }
+
+    /* Whatever is left over */
+    updateScalar<INTEGRATOR, SPRING, NEIGHBOURS>(ps, i, end, gravity);
+}
+
+#endif /* SIMD_X86 */
+
+//--------------------------------------------------------------
+/* Every backend is built once for every integrator, spring model and with or without the
+ * neighbour forces, indexed in that order. Picking one is a table lookup per call, not a branch
+ * per particle
+ */
+typedef void (*UpdateFunction)(ParticleSystem &ps, int begin, int end, ofVec2f gravity);
+
+#define KERNEL_PAIR(kernel, integrator, spring) {kernel<integrator, spring, false>, kernel<integrator, spring, true>}
+#define KERNEL_ROW(kernel, integrator) {KERNEL_PAIR(kernel, integrator, ParticleKernel::LINEAR_SPRING), KERNEL_PAIR(kernel, integrator, ParticleKernel::ZERO_LENGTH_SPRING)}
+#define KERNEL_VARIANTS(kernel) {KERNEL_ROW(kernel, ParticleSystem::SEMI_IMPLICIT_EULER), KERNEL_ROW(kernel, ParticleSystem::POSITION_VERLET), KERNEL_ROW(kernel, ParticleSystem::VELOCITY_VERLET)}
+
+static const UpdateFunction scalarVariants[3][2][2] = KERNEL_VARIANTS(updateScalar);
+
+#ifdef SIMD_X86
+static const UpdateFunction sseVariants[3][2][2] = KERNEL_VARIANTS(updateSse);
+static const UpdateFunction avx2Variants[3][2][2] = KERNEL_VARIANTS(updateAvx2);
+#endif
+
+//--------------------------------------------------------------
+static UpdateFunction getUpdateFunction(ParticleKernel::Backend backend, ParticleSystem::Integrator integrator, ParticleKernel::SpringModel spring, bool neighbours){
+#ifdef SIMD_X86
+    if(backend == ParticleKernel::AVX2)
+    {
+        return avx2Variants[integrator][spring][neighbours];
+    }
+    else if(backend == ParticleKernel::SSE)
+    {
+        return sseVariants[integrator][spring][neighbours];
+    }
+#endif
+    return scalarVariants[integrator][spring][neighbours];
+}
+
+//--------------------------------------------------------------
+ParticleKernel::ParticleKernel(){
+    /* Use the best instruction set this CPU has */
+    backend = getBestBackend();
+}
+
+//--------------------------------------------------------------
+void ParticleKernel::update(ParticleSystem &ps, int begin, int end, ofVec2f gravity){
+    getUpdateFunction(backend, ps.integrator, getSpringModel(ps), ps.neighbourForces)(ps, begin, end, gravity);
+}
+
+//--------------------------------------------------------------
+/* Runs one step on two copies of the particles, one with ParticleSystem::step and one with this
+ * backend, and returns the biggest difference in position, velocity or force. The copies get
+ * some velocity, force and flow force first so that every branch is exercised, not just the rest
+ * state. Every variant is checked, not only the one in use right now
+ */
+float ParticleKernel::validate(const ParticleSystem &ps, ofVec2f gravity){
+
+    /* Give a copy some made up state */
+    ParticleSystem start = ps;
+    for(int i=0; i<start.size(); i++){
+        start.velX[i] = sin(i * 0.37) * 2;
+        start.velY[i] = cos(i * 0.61) * 2;
+        start.posX[i] += sin(i * 0.13) * 80;
+        start.posY[i] += cos(i * 0.29) * 80;
+        start.frcX[i] = sin(i * 0.43) * 0.1;
+        start.frcY[i] = cos(i * 0.47) * 0.1;
+        start.cvForceX[i] = sin(i * 0.71) * 0.5;
+        start.cvForceY[i] = cos(i * 0.53) * 0.5;
+    }
+
+    float maxError = 0;
+    for(int integrator=0; integrator<3; integrator++){
+        for(int spring=0; spring<2; spring++){
+            for(int neighbours=0; neighbours<2; neighbours++){
+
+                /* The linear model has to match with or without a rest length, the zero length one
+                 * only without. step() always adds the neighbour force, so it is zero when the
+                 * kernel leaves it out
+                 */
+                ParticleSystem reference = start;
+                reference.integrator = (ParticleSystem::Integrator)integrator;
+                reference.springLength = spring == ZERO_LENGTH_SPRING ? 0 : 4;
+                for(int i=0; i<reference.size(); i++){
+                    reference.repelX[i] = neighbours ? sin(i * 0.59) * 0.2 : 0;
+                    reference.repelY[i] = neighbours ? cos(i * 0.67) * 0.2 : 0;
+                }
+                ParticleSystem tested = reference;
+
+                /* Update one the way ofApp used to and one with this backend */
+                for(int i=0; i<reference.size(); i++){
+                    reference.step(i, gravity);
+                }
+                getUpdateFunction(backend, reference.integrator, (SpringModel)spring, neighbours)(tested, 0, tested.size(), gravity);
+
+                /* Find the biggest difference */
+                for(int i=0; i<reference.size(); i++){
+                    maxError = MAX(maxError, fabs(reference.posX[i] - tested.posX[i]));
+                    maxError = MAX(maxError, fabs(reference.posY[i] - tested.posY[i]));
+                    maxError = MAX(maxError, fabs(reference.velX[i] - tested.velX[i]));
+                    maxError = MAX(maxError, fabs(reference.velY[i] - tested.velY[i]));
+                    maxError = MAX(maxError, fabs(reference.frcX[i] - tested.frcX[i]));
+                    maxError = MAX(maxError, fabs(reference.frcY[i] - tested.frcY[i]));
+                }
+            }
+        }
+    }
+
+    return maxError;
+}
+
+//--------------------------------------------------------------
+/* validate() only compares the backends with each other, so if the square root trick drifted
+ * from the spring the program started with they would all drift together. This puts particles
+ * from a hundredth of a pixel to just past the break length away from their origins, in every
+ * direction, and checks the force against stiffness * (length - rest) * direction worked out in
+ * doubles with a length and a normalize, like Spring::update did. It is done with and without a
+ * rest length. A spring that breaks when the original wouldn't, or the other way round, counts as
+ * an error of 1
+ */
+float ParticleKernel::validateSprings(const ParticleSystem &ps){
+
+    /* Use the first few particles of a copy, adding new ones would use up random numbers */
+    ParticleSystem test = ps;
+    int count = MIN(256, test.size());
+    if(count == 0)
+    {
+        return 0;
+    }
+    test.setBounds(10000, 10000);
+    test.integrator = ParticleSystem::SEMI_IMPLICIT_EULER;
+    test.neighbourForces = false;
+    double breakLength = test.springBreakLength;
+    double shortest = 0.01;
+    double longest = breakLength * 1.05;
+
+    float maxError = 0;
+    for(int spring=0; spring<2; spring++){
+        test.springLength = spring == ZERO_LENGTH_SPRING ? 0 : 4;
+
+        /* Lengths spaced evenly on a log scale so the tiny ones get as many as the long ones */
+        vector<double> lengths(count);
+        for(int i=0; i<count; i++){
+            lengths[i] = shortest * pow(longest / shortest, (double)i / MAX(count - 1, 1));
+            double angle = i * 2.39996;
+            test.originX[i] = 5000;
+            test.originY[i] = 5000;
+            test.posX[i] = 5000 + lengths[i] * cos(angle);
+            test.posY[i] = 5000 + lengths[i] * sin(angle);
+            test.velX[i] = 0;
+            test.velY[i] = 0;
+            test.frcX[i] = 0;
+            test.frcY[i] = 0;
+            test.cvForceX[i] = 0;
+            test.cvForceY[i] = 0;
+            test.repelX[i] = 0;
+            test.repelY[i] = 0;
+            test.flags[i] = ParticleSystem::DO_PHYSICS | ParticleSystem::DO_SPRING;
+        }
+        vector<float> startX(test.posX.begin(), test.posX.begin() + count);
+        vector<float> startY(test.posY.begin(), test.posY.begin() + count);
+
+        /* With no gravity, flow or velocity the force after one step is just the spring */
+        ParticleSystem tested = test;
+        getUpdateFunction(backend, tested.integrator, (SpringModel)spring, false)(tested, 0, count, ofVec2f(0, 0));
+
+        for(int i=0; i<count; i++){
+            double dx = startX[i] - test.originX[i];
+            double dy = startY[i] - test.originY[i];
+            double d = sqrt(dx * dx + dy * dy);
+            double stretched = d - test.springLength;
+            double expectedX = d > 0 ? test.springStiffness * stretched * dx / d : 0;
+            double expectedY = d > 0 ? test.springStiffness * stretched * dy / d : 0;
+
+            /* Relative to the force a spring this long pulls with, so tiny and huge ones count the same */
+            double scale = fabs(test.springStiffness) * MAX(d, (double)test.springLength);
+            if(scale > 0)
+            {
+                maxError = MAX(maxError, fabs(tested.frcX[i] - expectedX) / scale);
+                maxError = MAX(maxError, fabs(tested.frcY[i] - expectedY) / scale);
+            }
+
+            /* Right on the break length rounding can go either way */
+            bool broke = !(tested.flags[i] & ParticleSystem::DO_SPRING);
+            if(fabs(d - breakLength) > 0.001 && broke != (d > breakLength))
+            {
+                maxError = 1;
+            }
+        }
+    }
+
+    return maxError;
+}
+
+//--------------------------------------------------------------
+void ParticleKernel::setBackend(Backend _backend){
+    /* Never pick something this CPU can't run */
+    Backend best = getBestBackend();
+    backend = _backend > best ? best : _backend;
+}
+
+//--------------------------------------------------------------
+ParticleKernel::Backend ParticleKernel::getBackend(){
+    return backend;
+}
+
+//--------------------------------------------------------------
+ParticleKernel::SpringModel ParticleKernel::getSpringModel(const ParticleSystem &ps){
+    return ps.springLength == 0 ? ZERO_LENGTH_SPRING : LINEAR_SPRING;
+}
+
+//--------------------------------------------------------------
+string ParticleKernel::getBackendName(){
+    if(backend == AVX2)
+    {
+        return "AVX2";
+    }
+    else if(backend == SSE)
+    {
+        return "SSE";
+    }
+    return "Scalar";
+}
+
+//--------------------------------------------------------------
+/* Ask the CPU which instruction sets it supports */
+ParticleKernel::Backend ParticleKernel::getBestBackend(){
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+    if(__builtin_cpu_supports("sse2"))
+    {
+        return SSE;
+    }
+#elif defined(SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int numIds = info[0];
+    __cpuid(info, 1);
+    bool hasSse = info[3] & (1 << 26);
+
+    /* AVX2 also needs the OS to save the wide registers, which is what OSXSAVE and xgetbv tell us */
+    bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+    if(numIds >= 7 && osSavesAvx)
+    {
+        __cpuidex(info, 7, 0);
+        if(info[1] & (1 << 5))
+        {
+            return AVX2;
+        }
+    }
+    if(hasSse)
+    {
+        return SSE;
+    }
+#endif
+    return SCALAR;
+}
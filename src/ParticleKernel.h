@@ -0,0 +1,77 @@
+//
+//  ParticleKernel.h
+//
+//
+
+#ifndef ParticleKernel_h
+#define ParticleKernel_h
+
+/* Includes */
+#include "ofMain.h"
+#include "ParticleSystem.h"
+
+/* This class runs one physics step over a range of particles in a ParticleSystem. It does the
+ * same as calling resetForce, addForce, addCvForce, dampenForce and update on every particle, but
+ * processes 4 (SSE) or 8 (AVX2) particles at once. The best instruction set is picked at runtime,
+ * with a scalar fallback for other CPUs.
+ *
+ * Particles that are still attached to their spring take the vector path. A batch that has any
+ * free or returning particle in it falls back to the scalar path, since those need edges() and
+ * the reset logic, and there are very few of them most of the time. Repulsion is only ever set
+ * on particles in the FREE state, which have lost their spring and always take the scalar path.
+ * Settling particles still have a free bit but are back on their spring and take the vector
+ * path, so Simulation::addRepulsion leaves them at zero. Only the spring network puts a force
+ * on attached particles, and then the particle system says they have neighbour forces.
+ *
+ * The integrator, the spring model and whether there are neighbour forces are template
+ * parameters of the kernels rather than branches inside them. Every combination is compiled on
+ * its own, with the tests on them folded away, and update() looks the right one up in a table.
+ * The damping and flow numbers come from ParticleConstants and are folded in the same way, only
+ * the things that can be changed while the program runs (dt, gravity and the spring settings)
+ * are read from the particle system.
+*/
+
+class ParticleKernel{
+public:
+    /* The instruction sets the kernel can use */
+    enum Backend {
+        SCALAR,
+        SSE,
+        AVX2
+    };
+
+    /* How the spring force is worked out. By default the springs have no rest length, so the
+     * force is just the stretch times the stiffness, which needs no square root or division. The
+     * linear model handles any rest length with one reciprocal square root
+     */
+    enum SpringModel {
+        LINEAR_SPRING,
+        ZERO_LENGTH_SPRING
+    };
+
+    /* Constructor, picks the best backend for this CPU */
+    ParticleKernel();
+
+    /* Update the particles from begin to end, the flow force is read from cvForceX/Y */
+    void update(ParticleSystem &ps, int begin, int end, ofVec2f gravity);
+
+    /* Compare this backend against ParticleSystem::step and return the largest difference */
+    float validate(const ParticleSystem &ps, ofVec2f gravity);
+
+    /* Compare this backend's spring force against the original Spring::update maths and return
+     * the largest difference, relative to how big the force is
+     */
+    float validateSprings(const ParticleSystem &ps);
+
+    /* Getters and setters */
+    void setBackend(Backend _backend);
+    Backend getBackend();
+    string getBackendName();
+    static Backend getBestBackend();
+    static SpringModel getSpringModel(const ParticleSystem &ps);
+
+    /* Variables */
+    Backend backend;
+};
+
+#endif /* ParticleKernel_h */
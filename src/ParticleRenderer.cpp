@@ -0,0 +1,158 @@
+//
+//  ParticleRenderer.cpp
+//
+//
+
+#include "ParticleRenderer.h"
+
+/* The vertex shader blends between the last two ticks and passes the texture coordinate through,
+ * every pixel of a point gets the same one
+ */
+static const string vertexShader =
+    "#version 120\n"
+    "uniform float alpha;\n"
+    "attribute float prevX;\n"
+    "attribute float prevY;\n"
+    "attribute float posX;\n"
+    "attribute float posY;\n"
+    "attribute vec2 texCoord;\n"
+    "varying vec2 cameraCoord;\n"
+    "void main(){\n"
+    "    cameraCoord = texCoord;\n"
+    "    vec2 position = mix(vec2(prevX, prevY), vec2(posX, posY), alpha);\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+/* The fragment shader looks the color up in the webcam image */
+static const string fragmentShader =
+    "#version 120\n"
+    "uniform sampler2D camera;\n"
+    "varying vec2 cameraCoord;\n"
+    "void main(){\n"
+    "    gl_FragColor = vec4(texture2D(camera, cameraCoord).rgb, 1.0);\n"
+    "}\n";
+
+//--------------------------------------------------------------
+ParticleRenderer::ParticleRenderer(){
+    positionBuffer = 0;
+    texCoordBuffer = 0;
+    prevXLocation = -1;
+    prevYLocation = -1;
+    posXLocation = -1;
+    posYLocation = -1;
+    texCoordLocation = -1;
+    numVertices = 0;
+    alpha = 1;
+}
+
+//--------------------------------------------------------------
+ParticleRenderer::~ParticleRenderer(){
+    if(positionBuffer != 0)
+    {
+        glDeleteBuffers(1, &positionBuffer);
+        glDeleteBuffers(1, &texCoordBuffer);
+    }
+}
+
+//--------------------------------------------------------------
+void ParticleRenderer::setup(ParticleSystem &ps, int imageW, int imageH, float imageScale){
+
+    /* Build the shader and find where the attributes went */
+    shader.setupShaderFromSource(GL_VERTEX_SHADER, vertexShader);
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragmentShader);
+    shader.linkProgram();
+    prevXLocation = shader.getAttributeLocation("prevX");
+    prevYLocation = shader.getAttributeLocation("prevY");
+    posXLocation = shader.getAttributeLocation("posX");
+    posYLocation = shader.getAttributeLocation("posY");
+    texCoordLocation = shader.getAttributeLocation("texCoord");
+
+    /* A normal (not rectangle) texture so the coordinates go from 0 to 1, nearest so each
+     * particle gets exactly one pixel like ofPixels::getColor did. Black until the first frame
+     */
+    ofPixels black;
+    black.allocate(imageW, imageH, OF_PIXELS_RGB);
+    black.set(0);
+    camTexture.allocate(imageW, imageH, GL_RGB, false);
+    camTexture.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    camTexture.loadData(black);
+
+    /* The texture coordinate of the pixel under each origin. The origins never move so this
+     * second buffer is only uploaded here
+     */
+    numVertices = ps.size();
+    vector<float> texCoords(numVertices * 2);
+    for(int i=0; i<numVertices; i++){
+        int x = MAX(0, MIN((int)(ps.originX[i] * imageScale), imageW - 1));
+        int y = MAX(0, MIN((int)(ps.originY[i] * imageScale), imageH - 1));
+        texCoords[i * 2] = (x + 0.5) / imageW;
+        texCoords[i * 2 + 1] = (y + 0.5) / imageH;
+    }
+
+    glGenBuffers(1, &positionBuffer);
+    upload(ps);
+
+    glGenBuffers(1, &texCoordBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(float), texCoords.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//--------------------------------------------------------------
+void ParticleRenderer::setImage(const ofPixels &image){
+    camTexture.loadData(image);
+}
+
+//--------------------------------------------------------------
+/* Sleeping tiles have prev and pos the same, so they stay put whatever alpha is */
+void ParticleRenderer::update(ParticleSystem &ps, float _alpha, bool moved){
+    alpha = _alpha;
+    if(moved)
+    {
+        upload(ps);
+    }
+}
+
+//--------------------------------------------------------------
+void ParticleRenderer::upload(ParticleSystem &ps){
+    size_t arrayBytes = numVertices * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+
+    /* Orphan the old buffer, the driver gives us fresh memory while the GPU finishes with the old one */
+    glBufferData(GL_ARRAY_BUFFER, arrayBytes * 4, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, arrayBytes, ps.prevX.data());
+    glBufferSubData(GL_ARRAY_BUFFER, arrayBytes, arrayBytes, ps.prevY.data());
+    glBufferSubData(GL_ARRAY_BUFFER, arrayBytes * 2, arrayBytes, ps.posX.data());
+    glBufferSubData(GL_ARRAY_BUFFER, arrayBytes * 3, arrayBytes, ps.posY.data());
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//--------------------------------------------------------------
+void ParticleRenderer::draw(){
+    shader.begin();
+    shader.setUniformTexture("camera", camTexture, 0);
+    shader.setUniform1f("alpha", alpha);
+
+    /* The four position arrays sit one after the other, the texture coordinate never changes */
+    size_t arrayBytes = numVertices * sizeof(float);
+    GLint positionLocations[4] = {prevXLocation, prevYLocation, posXLocation, posYLocation};
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    for(int a=0; a<4; a++){
+        glEnableVertexAttribArray(positionLocations[a]);
+        glVertexAttribPointer(positionLocations[a], 1, GL_FLOAT, GL_FALSE, 0, (void*)(arrayBytes * a));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+    glEnableVertexAttribArray(texCoordLocation);
+    glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+    glDrawArrays(GL_POINTS, 0, numVertices);
+
+    for(int a=0; a<4; a++){
+        glDisableVertexAttribArray(positionLocations[a]);
+    }
+    glDisableVertexAttribArray(texCoordLocation);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    shader.end();
+}
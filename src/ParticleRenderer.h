@@ -0,0 +1,64 @@
+//
+//  ParticleRenderer.h
+//
+//
+
+#ifndef ParticleRenderer_h
+#define ParticleRenderer_h
+
+/* Includes */
+#include "ofMain.h"
+#include "ParticleSystem.h"
+
+/* This class draws the particles as points straight from the particle system. ofMesh keeps its
+ * own copy of every vertex as an ofVec3f and an ofFloatColor and uploads all of it on every
+ * draw. Here nothing is copied on the CPU at all: prevX, prevY, posX and posY are uploaded
+ * straight out of the particle system's arrays, one after the other into one buffer, and each is
+ * read as an attribute of its own.
+ *
+ * The vertex shader blends each particle from where it was at the last tick to where it is now,
+ * so the only thing that changes on a frame without a physics tick is one uniform. The buffer is
+ * only uploaded after a tick, into fresh memory, the old one is orphaned so we never wait for the
+ * GPU to finish drawing the last frame.
+ *
+ * The color comes from the webcam image, which is uploaded as a texture once per new camera
+ * frame. Each particle always takes its color from the same spot (its origin), so those texture
+ * coordinates go in a second buffer that is only uploaded once and the shader does the lookup.
+*/
+
+class ParticleRenderer{
+public:
+    /* Constructor */
+    ParticleRenderer();
+    ~ParticleRenderer();
+
+    /* Create the buffers, texture and shader, the image is the size of the webcam frames and
+     * imageScale goes from screen coordinates to image coordinates
+     */
+    void setup(ParticleSystem &ps, int imageW, int imageH, float imageScale);
+
+    /* Upload a new webcam image */
+    void setImage(const ofPixels &image);
+
+    /* Upload the positions if the particles moved since the last call. Alpha goes from where the
+     * particles were at the last tick (0) to where they are now (1)
+     */
+    void update(ParticleSystem &ps, float _alpha, bool moved);
+
+    /* Draw the points */
+    void draw();
+
+private:
+    /* Put the four position arrays into a fresh buffer */
+    void upload(ParticleSystem &ps);
+
+    /* Variables */
+    GLuint positionBuffer, texCoordBuffer;
+    GLint prevXLocation, prevYLocation, posXLocation, posYLocation, texCoordLocation;
+    ofShader shader;
+    ofTexture camTexture;
+    int numVertices;
+    float alpha;
+};
+
+#endif /* ParticleRenderer_h */
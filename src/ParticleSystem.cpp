@@ -0,0 +1,499 @@
+//
+//  ParticleSystem.cpp
+//
+//
+
+#include "ParticleSystem.h"
+#include "ParticleConstants.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//--------------------------------------------------------------
+ParticleSystem::ParticleSystem(){
+    /* Set default values, these match the Particle and Spring classes */
+    radius = 1;
+    width = 0;
+    height = 0;
+    springLength = 0;
+    springStiffness = ParticleConstants::springStiffness;
+    springBreakLength = ParticleConstants::springBreakLength;
+    dt = 1;
+    integrator = SEMI_IMPLICIT_EULER;
+    neighbourForces = false;
+}
+
+//--------------------------------------------------------------
+/* Set the size of the area the particles bounce around in, usually the window size */
+void ParticleSystem::setBounds(float _width, float _height){
+    width = _width;
+    height = _height;
+}
+
+//--------------------------------------------------------------
+/* Reserve space in every array up front so adding particles does not reallocate */
+void ParticleSystem::reserve(int n){
+    posX.reserve(n);
+    posY.reserve(n);
+    velX.reserve(n);
+    velY.reserve(n);
+    frcX.reserve(n);
+    frcY.reserve(n);
+    originX.reserve(n);
+    originY.reserve(n);
+    lastPosX.reserve(n);
+    lastPosY.reserve(n);
+    prevX.reserve(n);
+    prevY.reserve(n);
+    life.reserve(n);
+    maxLife.reserve(n);
+    maxLifeOffset.reserve(n);
+    flags.reserve(n);
+    freeBits.reserve((n + 63) / 64);
+    returningBits.reserve((n + 63) / 64);
+    settlingBits.reserve((n + 63) / 64);
+    cvForceX.reserve(n);
+    cvForceY.reserve(n);
+    repelX.reserve(n);
+    repelY.reserve(n);
+}
+
+//--------------------------------------------------------------
+/* Adds a particle and returns its index, this does the same as the Particle constructor */
+int ParticleSystem::addParticle(ofVec2f _pos, float _radius){
+    radius = _radius;
+
+    posX.push_back(_pos.x);
+    posY.push_back(_pos.y);
+    velX.push_back(0);
+    velY.push_back(0);
+    frcX.push_back(0);
+    frcY.push_back(0);
+    originX.push_back(_pos.x);
+    originY.push_back(_pos.y);
+    lastPosX.push_back(_pos.x);
+    lastPosY.push_back(_pos.y);
+    prevX.push_back(_pos.x);
+    prevY.push_back(_pos.y);
+    life.push_back(0);
+    maxLife.push_back(ofRandom(1000, 5000));
+    maxLifeOffset.push_back(ofRandom(250, 2000));
+    flags.push_back(DO_PHYSICS | DO_SPRING);
+
+    /* Every 64th particle starts a new lifecycle word */
+    if((posX.size() - 1) % 64 == 0)
+    {
+        freeBits.push_back(0);
+        returningBits.push_back(0);
+        settlingBits.push_back(0);
+    }
+    cvForceX.push_back(0);
+    cvForceY.push_back(0);
+    repelX.push_back(0);
+    repelY.push_back(0);
+
+    return posX.size() - 1;
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::clear(){
+    posX.clear();
+    posY.clear();
+    velX.clear();
+    velY.clear();
+    frcX.clear();
+    frcY.clear();
+    originX.clear();
+    originY.clear();
+    lastPosX.clear();
+    lastPosY.clear();
+    prevX.clear();
+    prevY.clear();
+    life.clear();
+    maxLife.clear();
+    maxLifeOffset.clear();
+    flags.clear();
+    freeBits.clear();
+    returningBits.clear();
+    settlingBits.clear();
+    cvForceX.clear();
+    cvForceY.clear();
+    repelX.clear();
+    repelY.clear();
+}
+
+//--------------------------------------------------------------
+int ParticleSystem::size(){
+    return posX.size();
+}
+
+//--------------------------------------------------------------
+/* One full physics step for a particle, the same order ofApp used to call the functions in */
+void ParticleSystem::step(int i, ofVec2f gravity){
+
+    /* The Verlet schemes move the particle, or kick it with last step's force, before the new forces are worked out */
+    if(flags[i] & DO_PHYSICS)
+    {
+        if(integrator == POSITION_VERLET)
+        {
+            drift(i, dt * 0.5f);
+        }
+        else if(integrator == VELOCITY_VERLET)
+        {
+            kick(i, dt * 0.5f);
+            drift(i, dt);
+        }
+    }
+
+    resetForce(i);
+    addForce(i, gravity);
+    addCvForce(i, ofVec2f(cvForceX[i], cvForceY[i]));
+    addForce(i, ofVec2f(repelX[i], repelY[i]));
+    dampenForce(i);
+    update(i);
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::update(int i){
+
+    if(!(flags[i] & DO_SPRING))
+    {
+        /* Only check if we have collided with the edges if we are not calculating the spring */
+        edges(i);
+    }
+
+    /* Calculate the spring force */
+    calcSpring(i);
+
+    if(flags[i] & DO_PHYSICS)
+    {
+        /* Calculate the physics, basic newtonian physics */
+        integrate(i);
+    }
+}
+
+//--------------------------------------------------------------
+/* The rest of the step once the forces are known, the Verlet schemes did their first half in step() */
+void ParticleSystem::integrate(int i){
+    if(integrator == SEMI_IMPLICIT_EULER)
+    {
+        kick(i, dt);
+        drift(i, dt);
+    }
+    else if(integrator == POSITION_VERLET)
+    {
+        kick(i, dt);
+        drift(i, dt * 0.5f);
+    }
+    else
+    {
+        kick(i, dt * 0.5f);
+    }
+}
+
+//--------------------------------------------------------------
+/* Change the velocity by the force over h frames */
+void ParticleSystem::kick(int i, float h){
+    velX[i] += frcX[i] * h;
+    velY[i] += frcY[i] * h;
+}
+
+//--------------------------------------------------------------
+/* Move the particle by its velocity over h frames */
+void ParticleSystem::drift(int i, float h){
+    posX[i] += velX[i] * h;
+    posY[i] += velY[i] * h;
+}
+
+//--------------------------------------------------------------
+/* The same as Spring::update and Spring::calcCurrentLength, the anchor is the origin */
+void ParticleSystem::calcSpring(int i){
+
+    if(flags[i] & DO_SPRING)
+    {
+        /* Get the difference between the anchor point of the spring and the other end */
+        float dx = posX[i] - originX[i];
+        float dy = posY[i] - originY[i];
+        float d2 = dx * dx + dy * dy;
+
+        /* Normalizing and scaling by the stretch is (d - springLength) / d, one square root does both */
+        if(d2 > 0)
+        {
+            float k = springStiffness - springStiffness * springLength / sqrtf(d2);
+            frcX[i] += dx * k;
+            frcY[i] += dy * k;
+        }
+
+        /* Break the spring if it is stretched too far, comparing the squares saves a square root */
+        if(d2 > springBreakLength * springBreakLength)
+        {
+            flags[i] &= ~DO_SPRING;
+        }
+    }
+    else
+    {
+        /* Set isFree to true */
+        freeBits[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::addForce(int i, ofVec2f f){
+    /* Add a user defined force */
+    frcX[i] += f.x;
+    frcY[i] += f.y;
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::dampenForce(int i){
+    /* Dampen the force */
+    frcX[i] = frcX[i] - velX[i] * ParticleConstants::damping;
+    frcY[i] = frcY[i] - velY[i] * ParticleConstants::damping;
+}
+
+//--------------------------------------------------------------
+/* Calculates a force from the openCV optical flow velocities that are passed in */
+void ParticleSystem::addCvForce(int i, ofVec2f f){
+
+    /* Get the length of the incoming force and limit the length */
+    float aLen = MIN(f.length(), ParticleConstants::cvMax);
+
+    if(aLen >= ParticleConstants::cvMin)
+    {
+        /* Calculate a force and add it */
+        float sX = ParticleConstants::cvGain * aLen * f.x;
+        float sY = ParticleConstants::cvGain * aLen * f.y;
+        frcX[i] += sX;
+        frcY[i] += sY;
+    }
+}
+
+//--------------------------------------------------------------
+/* This function handles reseting the particles to there original positions. It goes through
+ * the lifecycle words of begin to end, which has to start on a multiple of 64, and each stage
+ * only loops over its own particles. Every free particle moves on by one tick of life
+ */
+void ParticleSystem::resetRange(int begin, int end){
+
+    for(int w=begin / 64; w<(end + 63) / 64; w++){
+
+        /* Nothing to do for a word that is all attached, which is almost all of them */
+        uint64_t free = freeBits[w];
+        if(free == 0)
+        {
+            continue;
+        }
+
+        int first = w * 64;
+        uint64_t returning = returningBits[w];
+        uint64_t settling = settlingBits[w];
+        uint64_t loose = free & ~returning & ~settling;
+
+        /* Back on the grid for a tick, they are attached again */
+        for(uint64_t bits=settling; bits!=0; bits&=bits - 1){
+            life[first + lowestBit(bits)] = 0;
+        }
+        free &= ~settling;
+        settling = 0;
+
+        /* Lerp from the last position saved to the origin point, makes the grid again. The
+         * ones that got there this tick are picked out after the loop
+         */
+        uint64_t arrived = 0;
+        for(uint64_t bits=returning; bits!=0; bits&=bits - 1){
+            int bit = lowestBit(bits);
+            int i = first + bit;
+            int age = ++life[i] - maxLife[i];
+            float lerpAmt = (float)age / maxLifeOffset[i];
+            posX[i] = lastPosX[i] + (originX[i] - lastPosX[i]) * lerpAmt;
+            posY[i] = lastPosY[i] + (originY[i] - lastPosY[i]) * lerpAmt;
+            arrived |= (uint64_t)(age >= maxLifeOffset[i]) << bit;
+        }
+        for(uint64_t bits=arrived; bits!=0; bits&=bits - 1){
+            int i = first + lowestBit(bits);
+
+            /* Reset the velocity and force */
+            resetVelocity(i);
+            resetForce(i);
+
+            /* Make sure the position is equal to the origin */
+            posX[i] = originX[i];
+            posY[i] = originY[i];
+
+            /* Set doPhysics back to true and enable the spring again */
+            flags[i] |= DO_PHYSICS | DO_SPRING;
+        }
+        returning &= ~arrived;
+        settling |= arrived;
+
+        /* Free particles save where they are until their life runs out, then they start going back */
+        for(uint64_t bits=loose; bits!=0; bits&=bits - 1){
+            int bit = lowestBit(bits);
+            int i = first + bit;
+            if(++life[i] < maxLife[i])
+            {
+                /* Update the last position */
+                lastPosX[i] = posX[i];
+                lastPosY[i] = posY[i];
+            }
+            else
+            {
+                /* Set do physics to false, the lerp starts from the last position */
+                flags[i] &= ~DO_PHYSICS;
+                posX[i] = lastPosX[i];
+                posY[i] = lastPosY[i];
+                returning |= (uint64_t)1 << bit;
+            }
+        }
+
+        freeBits[w] = free;
+        returningBits[w] = returning;
+        settlingBits[w] = settling;
+    }
+}
+
+//--------------------------------------------------------------
+/* Check to see if a particle has collided with the edges of the screen */
+void ParticleSystem::edges(int i){
+    /* Bouncing off the edges */
+    if(posX[i] < 0)
+    {
+        posX[i] = 0; //Stops the object from getting caught
+        frcX[i] = frcX[i] - velX[i] * ParticleConstants::damping; // Apply some dampening when they collide
+        velX[i] *= -1; // Reverse the velocity
+    }
+    else if(posX[i] > width - radius)
+    {
+        posX[i] = width - radius;
+        frcX[i] = frcX[i] - velX[i] * ParticleConstants::damping;
+        velX[i] *= -1;
+    }
+    else if(posY[i] < 0)
+    {
+        posY[i] = 0;
+        frcY[i] = frcY[i] - velY[i] * ParticleConstants::damping;
+        velY[i] *= -1;
+    }
+    else if(posY[i] > height - radius)
+    {
+        posY[i] = height - radius;
+        frcY[i] = frcY[i] - velY[i] * ParticleConstants::damping;
+        velY[i] *= -1;
+    }
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::resetVelocity(int i){
+    /* Set the velocity to zero */
+    velX[i] = 0;
+    velY[i] = 0;
+}
+
+//--------------------------------------------------------------
+void ParticleSystem::resetForce(int i){
+    /* Set the force to zero */
+    frcX[i] = 0;
+    frcY[i] = 0;
+}
+
+//--------------------------------------------------------------
+ofVec2f ParticleSystem::getPosition(int i){
+    /* Return the position vector */
+    return ofVec2f(posX[i], posY[i]);
+}
+
+//--------------------------------------------------------------
+ofVec2f ParticleSystem::getOrigin(int i){
+    /* Return the origin vector */
+    return ofVec2f(originX[i], originY[i]);
+}
+
+//--------------------------------------------------------------
+bool ParticleSystem::getIsFree(int i){
+    /* Return isFree boolean */
+    return (freeBits[i >> 6] >> (i & 63)) & 1;
+}
+
+//--------------------------------------------------------------
+bool ParticleSystem::getDoSpring(int i){
+    /* Return doSpring boolean */
+    return flags[i] & DO_SPRING;
+}
+
+//--------------------------------------------------------------
+/* How many particles in begin to end aren't attached, begin has to be a multiple of 64 */
+int ParticleSystem::countFree(int begin, int end){
+    int count = 0;
+    for(int w=begin / 64; w<(end + 63) / 64; w++){
+        count += countBits(freeBits[w]);
+    }
+    return count;
+}
+
+//--------------------------------------------------------------
+ParticleSystem::Lifecycle ParticleSystem::getLifecycle(int i){
+    uint64_t bit = (uint64_t)1 << (i & 63);
+    if(!(freeBits[i >> 6] & bit))
+    {
+        return ATTACHED;
+    }
+    else if(returningBits[i >> 6] & bit)
+    {
+        return RETURNING;
+    }
+    else if(settlingBits[i >> 6] & bit)
+    {
+        return SETTLING;
+    }
+    return FREE;
+}
+
+//--------------------------------------------------------------
+uint64_t ParticleSystem::getLooseBits(int w){
+    return freeBits[w] & ~returningBits[w] & ~settlingBits[w];
+}
+
+//--------------------------------------------------------------
+int ParticleSystem::countBits(uint64_t bits){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for(; bits!=0; bits&=bits - 1){
+        count++;
+    }
+    return count;
+#endif
+}
+
+//--------------------------------------------------------------
+/* The index of the lowest set bit, bits must not be zero */
+int ParticleSystem::lowestBit(uint64_t bits){
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while(!(bits & 1)){
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+//--------------------------------------------------------------
+string ParticleSystem::getIntegratorName(Integrator _integrator){
+    if(_integrator == POSITION_VERLET)
+    {
+        return "position_verlet";
+    }
+    else if(_integrator == VELOCITY_VERLET)
+    {
+        return "velocity_verlet";
+    }
+    return "euler";
+}
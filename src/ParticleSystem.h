@@ -0,0 +1,131 @@
+//
+//  ParticleSystem.h
+//
+//
+
+#ifndef ParticleSystem_h
+#define ParticleSystem_h
+
+/* Includes */
+#include "ofMain.h"
+
+/* This is a structure-of-arrays version of the Particle class. Instead of one heap object per
+ * particle, every variable lives in its own contiguous array and a particle is just an index into
+ * those arrays. The update loop then only pulls in the data it actually touches, which is a lot
+ * kinder to the cache than chasing a vector of pointers.
+ *
+ * The functions mirror the ones in Particle and Spring, so the physics behaves exactly the same.
+ * The spring anchor is the origin and the rest length is zero, so nothing is duplicated per spring.
+ *
+ * Time is measured in frames of the original 60fps program, so with dt = 1 and semi-implicit
+ * Euler a step is exactly what Particle::update did. Smaller steps and the two Verlet schemes
+ * (drift-kick-drift and kick-drift-kick) stay stable with much stiffer springs.
+*/
+
+class ParticleSystem{
+public:
+    /* Constructor */
+    ParticleSystem();
+
+    /* Setup */
+    void setBounds(float _width, float _height);
+    void reserve(int n);
+    int addParticle(ofVec2f _pos, float _radius);
+    void clear();
+    int size();
+
+    /* Update, reset, etc. */
+    void step(int i, ofVec2f gravity);
+    void update(int i);
+    void integrate(int i);
+    void kick(int i, float h);
+    void drift(int i, float h);
+    void resetRange(int begin, int end);
+    void edges(int i);
+
+    /* Physics */
+    void addForce(int i, ofVec2f f);
+    void dampenForce(int i);
+    void resetForce(int i);
+    void resetVelocity(int i);
+    void addCvForce(int i, ofVec2f f);
+    void calcSpring(int i);
+
+    /* Getters */
+    ofVec2f getPosition(int i);
+    ofVec2f getOrigin(int i);
+    bool getIsFree(int i);
+    bool getDoSpring(int i);
+    int countFree(int begin, int end);
+
+    /* How the velocity and position are stepped forward */
+    enum Integrator {
+        SEMI_IMPLICIT_EULER,
+        POSITION_VERLET,
+        VELOCITY_VERLET
+    };
+    static string getIntegratorName(Integrator _integrator);
+
+    /* Bit flags stored per particle */
+    enum Flags {
+        DO_PHYSICS = 1 << 0,
+        DO_SPRING = 1 << 1
+    };
+
+    /* Where a particle is in its life. It starts attached to its spring and is free once the
+     * spring breaks. When its life runs out it goes back to its origin in a straight line, then
+     * sits on the grid for one tick before it counts as attached again
+     */
+    enum Lifecycle {
+        ATTACHED,
+        FREE,
+        RETURNING,
+        SETTLING
+    };
+    Lifecycle getLifecycle(int i);
+
+    /* The particles of lifecycle word w that are FREE, not returning or settling */
+    uint64_t getLooseBits(int w);
+
+    /* Bit tricks for the lifecycle words below */
+    static int countBits(uint64_t bits);
+    static int lowestBit(uint64_t bits);
+
+    /* Particle data, one entry per particle */
+    vector<float> posX, posY;
+    vector<float> velX, velY;
+    vector<float> frcX, frcY;
+    vector<float> originX, originY;
+    vector<float> lastPosX, lastPosY;
+
+    /* Where each particle was at the start of the last physics tick, for drawing in between ticks */
+    vector<float> prevX, prevY;
+    vector<int> life, maxLife, maxLifeOffset;
+    vector<unsigned char> flags;
+
+    /* The lifecycle, one bit per particle and 64 particles to a word. freeBits has every particle
+     * that isn't attached, the other two say which of those are returning or settling. Only words
+     * with a bit set are looked at, so the reset costs next to nothing while the grid is intact
+     */
+    vector<uint64_t> freeBits, returningBits, settlingBits;
+
+    /* The optical flow force for each particle, filled in before the particles are updated */
+    vector<float> cvForceX, cvForceY;
+
+    /* The push from neighbouring particles, zero unless repulsion or the spring network is turned
+     * on in the Simulation. Repulsion only pushes free particles, the network pulls on every one of
+     * them and sets neighbourForces so the kernels read this for attached particles as well
+     */
+    vector<float> repelX, repelY;
+    bool neighbourForces;
+
+    /* Variables shared by every particle */
+    float radius, width, height;
+    float springLength, springStiffness, springBreakLength;
+
+    /* The length of one step, in 60fps frames, and how it is integrated */
+    float dt;
+    Integrator integrator;
+};
+
+#endif /* ParticleSystem_h */
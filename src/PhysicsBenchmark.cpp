@@ -0,0 +1,179 @@
+//
+//  PhysicsBenchmark.cpp
+//
+//
+
+#include "PhysicsBenchmark.h"
+#include <chrono>
+#include <cstdio>
+
+//--------------------------------------------------------------
+PhysicsBenchmark::PhysicsBenchmark(){
+    /* From the grid the app uses up to one big enough for a wall of projectors */
+    gridSizes.push_back(120);
+    gridSizes.push_back(250);
+    gridSizes.push_back(500);
+    gridSizes.push_back(1000);
+    gridSizes.push_back(2000);
+    numSteps = 300;
+    warmupSteps = 10;
+    numThreads = 0;
+    repulsionRadius = 0;
+    networkStiffness = 0;
+    sleepSpeed = 0;
+    substeps = 1;
+    integrator = "euler";
+    sampling = "nearest";
+    replayPath = "";
+
+    /* The same size as the app window and flow */
+    width = 960;
+    height = 720;
+    decimate = 0.25;
+}
+
+//--------------------------------------------------------------
+void PhysicsBenchmark::parseArguments(int argc, char *argv[]){
+    for(int i=1; i<argc - 1; i++){
+        string arg = argv[i];
+        if(arg == "--threads")
+        {
+            numThreads = ofToInt(argv[i + 1]);
+        }
+        else if(arg == "--steps")
+        {
+            numSteps = MAX(1, ofToInt(argv[i + 1]));
+        }
+        else if(arg == "--repulsion")
+        {
+            repulsionRadius = ofToFloat(argv[i + 1]);
+        }
+        else if(arg == "--network")
+        {
+            networkStiffness = ofToFloat(argv[i + 1]);
+        }
+        else if(arg == "--sleep")
+        {
+            sleepSpeed = ofToFloat(argv[i + 1]);
+        }
+        else if(arg == "--substeps")
+        {
+            substeps = MAX(1, ofToInt(argv[i + 1]));
+        }
+        else if(arg == "--integrator")
+        {
+            integrator = argv[i + 1];
+        }
+        else if(arg == "--sampling")
+        {
+            sampling = argv[i + 1];
+        }
+        else if(arg == "--replay")
+        {
+            replayPath = argv[i + 1];
+        }
+        else if(arg == "--grids")
+        {
+            /* A comma separated list, like 120,500,1000 */
+            gridSizes.clear();
+            vector<string> sizes = ofSplitString(argv[i + 1], ",", true, true);
+            for(size_t s=0; s<sizes.size(); s++){
+                gridSizes.push_back(ofToInt(sizes[s]));
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void PhysicsBenchmark::run(){
+
+    WorkerPool pool;
+    pool.setup(numThreads);
+
+    SyntheticFlow::Pattern patterns[] = { SyntheticFlow::VORTEX, SyntheticFlow::SWEEP, SyntheticFlow::NOISE, SyntheticFlow::WAVE };
+    int numFlows = 4;
+
+    /* A recording replaces the made up flow, the particles fill the area it was recorded at */
+    FlowPlayer player;
+    if(!replayPath.empty())
+    {
+        if(!player.load(replayPath))
+        {
+            pool.stop();
+            return;
+        }
+        numFlows = 1;
+        width = player.width / player.scale;
+        height = player.height / player.scale;
+        decimate = player.scale;
+    }
+
+    printf("threads %d, %d steps after %d warmup steps, repulsion radius %g, network stiffness %g, %s with %d substeps, %s flow, sleep speed %g\n", pool.getNumThreads(), numSteps, warmupSteps, repulsionRadius, networkStiffness, integrator.c_str(), substeps, sampling.c_str(), sleepSpeed);
+    printf("%8s %10s %8s %12s %10s %10s %10s %8s %8s\n", "grid", "particles", "flow", "ns/particle", "steps/sec", "p50 ms", "p99 ms", "free", "awake");
+
+    for(size_t g=0; g<gridSizes.size(); g++){
+        for(int p=0; p<numFlows; p++){
+
+            /* Same random numbers every run so the results can be compared */
+            ofSeedRandom(0);
+
+            Simulation simulation;
+            simulation.setup(width, height, gridSizes[g], &pool);
+            simulation.setRepulsion(repulsionRadius, 0.05);
+            simulation.setNetwork(networkStiffness);
+            simulation.setSleep(sleepSpeed, 0.1);
+            simulation.setTimestep(substeps, integrator);
+            simulation.flowSampling = FlowField::getSampling(sampling);
+
+            SyntheticFlow flow;
+            flow.setup(width * decimate, height * decimate, decimate, patterns[p]);
+            FlowFrame frame;
+
+            /* Only the physics step is timed, not making the flow */
+            vector<double> times;
+            for(int step=0; step<warmupSteps + numSteps; step++){
+                if(player.isLoaded())
+                {
+                    player.getFrame(step % player.getNumFrames(), frame);
+                }
+                else
+                {
+                    flow.update(frame, step);
+                }
+
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                simulation.step(frame);
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+                if(step >= warmupSteps)
+                {
+                    times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+                }
+            }
+
+            /* Average, median and 99th percentile */
+            double total = 0;
+            for(size_t t=0; t<times.size(); t++){
+                total += times[t];
+            }
+            double mean = total / times.size();
+            sort(times.begin(), times.end());
+            double p50 = times[times.size() / 2];
+            double p99 = times[MIN(times.size() - 1, (size_t)(times.size() * 0.99))];
+            int numParticles = simulation.particles.size();
+
+            printf("%8d %10d %8s %12.2f %10.1f %10.3f %10.3f %8d %7.0f%%\n",
+                   gridSizes[g],
+                   numParticles,
+                   player.isLoaded() ? "replay" : SyntheticFlow::getPatternName(patterns[p]).c_str(),
+                   mean * 1000000.0 / numParticles,
+                   1000.0 / mean,
+                   p50,
+                   p99,
+                   simulation.freeParticleCount,
+                   100.0 * simulation.awakeTileCount / simulation.tileAwake.size());
+        }
+    }
+
+    pool.stop();
+}
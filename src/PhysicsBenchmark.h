@@ -0,0 +1,41 @@
+//
+//  PhysicsBenchmark.h
+//
+//
+
+#ifndef PhysicsBenchmark_h
+#define PhysicsBenchmark_h
+
+/* Includes */
+#include "ofMain.h"
+#include "Simulation.h"
+#include "SyntheticFlow.h"
+#include "FlowPlayer.h"
+
+/* Times the physics on its own, without a window, webcam or the openFrameworks loop. It builds
+ * the same grid ofApp does at a range of sizes, drives it with made up optical flow and prints
+ * how long each step took. Run the app with --bench to use it, see main.cpp.
+ *
+ * With --replay it uses a recording made with the recordFile setting instead of the made up
+ * flow. The frames are played one per step as fast as possible, so a run is repeatable.
+*/
+
+class PhysicsBenchmark{
+public:
+    /* Constructor, sets the default grid sizes and number of steps */
+    PhysicsBenchmark();
+
+    /* Read --threads, --steps, --grids, --repulsion, --network, --substeps, --integrator, --sampling, --sleep and --replay from the command line */
+    void parseArguments(int argc, char *argv[]);
+
+    /* Run every grid size with every flow pattern and print the results */
+    void run();
+
+    /* Variables */
+    vector<int> gridSizes;
+    int numSteps, warmupSteps, numThreads, substeps;
+    string integrator, sampling, replayPath;
+    float width, height, decimate, repulsionRadius, networkStiffness, sleepSpeed;
+};
+
+#endif /* PhysicsBenchmark_h */
@@ -0,0 +1,45 @@
+//
+//  PhysicsClock.cpp
+//
+//
+
+#include "PhysicsClock.h"
+
+//--------------------------------------------------------------
+PhysicsClock::PhysicsClock(){
+    tickSeconds = 1.0 / 60.0;
+    maxTicks = 4;
+    accumulator = 0;
+    totalTicks = 0;
+    droppedTicks = 0;
+}
+
+//--------------------------------------------------------------
+void PhysicsClock::setup(double _tickSeconds, int _maxTicks){
+    tickSeconds = _tickSeconds;
+    maxTicks = MAX(1, _maxTicks);
+    accumulator = 0;
+}
+
+//--------------------------------------------------------------
+int PhysicsClock::advance(double elapsedSeconds){
+    accumulator += MAX(elapsedSeconds, 0.0);
+
+    int ticks = (int)(accumulator / tickSeconds);
+    accumulator -= ticks * tickSeconds;
+
+    /* Too far behind, drop the ticks we can't afford */
+    if(ticks > maxTicks)
+    {
+        droppedTicks += ticks - maxTicks;
+        ticks = maxTicks;
+    }
+
+    totalTicks += ticks;
+    return ticks;
+}
+
+//--------------------------------------------------------------
+float PhysicsClock::getAlpha(){
+    return ofClamp(accumulator / tickSeconds, 0, 1);
+}
@@ -0,0 +1,41 @@
+//
+//  PhysicsClock.h
+//
+//
+
+#ifndef PhysicsClock_h
+#define PhysicsClock_h
+
+/* Includes */
+#include "ofMain.h"
+
+/* Turns the time between rendered frames into a whole number of fixed physics ticks, so the
+ * physics runs at the same speed at 30, 60 or 144 fps. Whatever time is left over is kept for
+ * the next frame, and getAlpha() says how far we are between the last tick and the next one so
+ * the particles can be drawn in between.
+ *
+ * If a frame takes very long (dragging the window, a hitch) only maxTicks are run and the rest
+ * is dropped, otherwise catching up would make the next frame even slower.
+*/
+
+class PhysicsClock{
+public:
+    /* Constructor, ticks at 60 per second which is what the physics was tuned for */
+    PhysicsClock();
+
+    /* Set the length of a tick and how many may run in one frame */
+    void setup(double _tickSeconds, int _maxTicks);
+
+    /* Add the time since the last frame and return how many ticks to run now */
+    int advance(double elapsedSeconds);
+
+    /* From 0 to 1, how far past the last tick we are */
+    float getAlpha();
+
+    /* Variables */
+    double tickSeconds, accumulator;
+    int maxTicks;
+    unsigned long long totalTicks, droppedTicks;
+};
+
+#endif /* PhysicsClock_h */
@@ -0,0 +1,105 @@
+//
+//  PipelineStats.cpp
+//
+//
+
+#include "PipelineStats.h"
+
+//--------------------------------------------------------------
+PipelineStats& PipelineStats::get(){
+    static PipelineStats stats;
+    return stats;
+}
+
+//--------------------------------------------------------------
+PipelineStats::PipelineStats(){
+    for(int s=0; s<NUM_STAGES; s++){
+        counters[s].frames = 0;
+        counters[s].busyMicros = 0;
+        counters[s].latencyFrames = 0;
+        counters[s].latencyMicros = 0;
+        counters[s].maxLatencyMicros = 0;
+        rates[s].framesPerSecond = 0;
+        rates[s].busy = 0;
+        rates[s].latencyMillis = 0;
+        rates[s].maxLatencyMillis = 0;
+    }
+    lastUpdate = 0;
+}
+
+//--------------------------------------------------------------
+void PipelineStats::record(Stage stage, uint64_t start, uint64_t end, uint64_t captureTime){
+    Counters &c = counters[stage];
+    c.frames++;
+    c.busyMicros += end - start;
+
+    if(captureTime > 0 && end > captureTime)
+    {
+        uint64_t latency = end - captureTime;
+        c.latencyFrames++;
+        c.latencyMicros += latency;
+
+        /* Only ever raise the maximum, another thread may be raising it at the same time */
+        uint64_t worst = c.maxLatencyMicros.load();
+        while(latency > worst && !c.maxLatencyMicros.compare_exchange_weak(worst, latency)){
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void PipelineStats::update(){
+    uint64_t now = ofGetElapsedTimeMicros();
+    if(lastUpdate == 0)
+    {
+        lastUpdate = now;
+        return;
+    }
+    if(now - lastUpdate < 1000000)
+    {
+        return;
+    }
+
+    /* Take everything counted since the last second and start counting again */
+    double seconds = (now - lastUpdate) / 1000000.0;
+    for(int s=0; s<NUM_STAGES; s++){
+        uint64_t frames = counters[s].frames.exchange(0);
+        uint64_t busy = counters[s].busyMicros.exchange(0);
+        uint64_t latencyFrames = counters[s].latencyFrames.exchange(0);
+        uint64_t latency = counters[s].latencyMicros.exchange(0);
+        uint64_t worst = counters[s].maxLatencyMicros.exchange(0);
+
+        rates[s].framesPerSecond = frames / seconds;
+        rates[s].busy = busy / (seconds * 1000000.0);
+        rates[s].latencyMillis = latencyFrames > 0 ? latency / 1000.0 / latencyFrames : 0;
+        rates[s].maxLatencyMillis = worst / 1000.0;
+    }
+    lastUpdate = now;
+}
+
+//--------------------------------------------------------------
+PipelineStats::Rates PipelineStats::getRates(Stage stage){
+    return rates[stage];
+}
+
+//--------------------------------------------------------------
+void PipelineStats::drawOverlay(float x, float y){
+    ofSetColor(255, 0, 0);
+    for(int s=0; s<NUM_STAGES; s++){
+        Rates &r = rates[s];
+        string line = getStageName((Stage)s) + ": " + ofToString(r.framesPerSecond, 1) + " fps, " + ofToString(r.busy * 100, 0) + "% busy, "
+                    + ofToString(r.latencyMillis, 1) + " ms since capture (" + ofToString(r.maxLatencyMillis, 1) + " max)";
+        ofDrawBitmapString(line, x, y + s * 12);
+    }
+    ofSetColor(255);
+}
+
+//--------------------------------------------------------------
+string PipelineStats::getStageName(Stage stage){
+    switch(stage){
+        case CAPTURE: return "capture";
+        case FLOW: return "flow";
+        case PHYSICS: return "physics";
+        case RENDER: return "render";
+        default: return "unknown";
+    }
+}
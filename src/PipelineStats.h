@@ -0,0 +1,72 @@
+//
+//  PipelineStats.h
+//
+//
+
+/* -Throughput and latency of each stage a camera frame goes through on its way to the screen:
+ *  capture (and shrink), flow, physics and render.
+ *
+ * -Every stage records when it started and finished a frame and when that frame came off the
+ *  camera. Once a second the main thread turns the counts into frames per second, how busy the
+ *  stage was and how old the frames were when the stage finished with them.
+ *
+ * -The stages run on different threads at the same time, so the pipeline should keep up with
+ *  its slowest stage, not with all of them added together. If a stage is busy close to 100% it
+ *  is the one holding the others back.
+ */
+
+#pragma once
+
+/* Includes */
+#include "ofMain.h"
+#include <atomic>
+
+class PipelineStats {
+
+public:
+
+    /* The stages in the order a frame goes through them */
+    enum Stage {
+        CAPTURE,
+        FLOW,
+        PHYSICS,
+        RENDER,
+        NUM_STAGES
+    };
+
+    /* What one stage did over the last second */
+    struct Rates {
+        float framesPerSecond;
+        float busy;
+        float latencyMillis, maxLatencyMillis;
+    };
+
+    /* There is only one, shared by every thread */
+    static PipelineStats& get();
+
+    /* A stage finished a frame, captureTime is when it came off the camera or zero if that isn't
+     * known. Safe to call from any thread
+     */
+    void record(Stage stage, uint64_t start, uint64_t end, uint64_t captureTime);
+
+    /* Main thread only, call once a frame, the rates change once a second */
+    void update();
+    Rates getRates(Stage stage);
+    void drawOverlay(float x, float y);
+
+    static string getStageName(Stage stage);
+
+private:
+
+    PipelineStats();
+
+    /* Added to by the stages, emptied by update() */
+    struct Counters {
+        std::atomic<uint64_t> frames, busyMicros;
+        std::atomic<uint64_t> latencyFrames, latencyMicros, maxLatencyMicros;
+    };
+
+    Counters counters[NUM_STAGES];
+    Rates rates[NUM_STAGES];
+    uint64_t lastUpdate;
+};
@@ -0,0 +1,178 @@
+//
+//  Profiler.cpp
+//
+//
+
+#include "Profiler.h"
+#include <fstream>
+
+//--------------------------------------------------------------
+Profiler& Profiler::get(){
+    static Profiler profiler;
+    return profiler;
+}
+
+//--------------------------------------------------------------
+Profiler::Profiler(){
+    for(int i=0; i<RING_SIZE; i++){
+        ring[i].sequence = 0;
+    }
+    head = 0;
+    numThreads = 0;
+}
+
+//--------------------------------------------------------------
+int Profiler::getThreadIndex(){
+    static thread_local int index = -1;
+    if(index < 0)
+    {
+        index = numThreads++;
+    }
+    return index;
+}
+
+//--------------------------------------------------------------
+void Profiler::record(Stage stage, uint64_t start, uint64_t end){
+
+    /* Claim the next slot, if the ring is full this overwrites the oldest record */
+    uint64_t index = head.fetch_add(1);
+    Record &r = ring[index % RING_SIZE];
+
+    /* Mark the slot as being written. A release store only keeps the writes before it in order,
+     * so the fence is what stops the record below from showing up before the zero does
+     */
+    r.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r.stage.store(stage, std::memory_order_relaxed);
+    r.thread.store(getThreadIndex(), std::memory_order_relaxed);
+    r.start.store(start, std::memory_order_relaxed);
+    r.end.store(end, std::memory_order_relaxed);
+    r.sequence.store(index + 1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+void Profiler::collect(vector<Sample> &out){
+    out.clear();
+
+    uint64_t last = head.load();
+    uint64_t first = last > RING_SIZE ? last - RING_SIZE : 0;
+
+    for(uint64_t index=first; index<last; index++){
+        Record &r = ring[index % RING_SIZE];
+
+        /* Read the sequence either side of the copy, if it changed a thread wrote to it meanwhile */
+        uint64_t before = r.sequence.load(std::memory_order_acquire);
+        Sample sample;
+        sample.stage = r.stage.load(std::memory_order_relaxed);
+        sample.thread = r.thread.load(std::memory_order_relaxed);
+        sample.start = r.start.load(std::memory_order_relaxed);
+        sample.end = r.end.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = r.sequence.load(std::memory_order_relaxed);
+
+        if(before == index + 1 && after == before)
+        {
+            out.push_back(sample);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+/* Average and worst time of each stage over the last second */
+void Profiler::drawOverlay(float x, float y){
+
+    vector<Sample> samples;
+    collect(samples);
+
+    uint64_t now = ofGetElapsedTimeMicros();
+    double total[NUM_STAGES] = {0};
+    double worst[NUM_STAGES] = {0};
+    int count[NUM_STAGES] = {0};
+
+    for(size_t i=0; i<samples.size(); i++){
+        /* Another thread can finish a sample after now was read, so no subtracting unsigned times */
+        if(samples[i].end + 1000000 < now)
+        {
+            continue;
+        }
+        double millis = (samples[i].end - samples[i].start) / 1000.0;
+        total[samples[i].stage] += millis;
+        worst[samples[i].stage] = MAX(worst[samples[i].stage], millis);
+        count[samples[i].stage]++;
+    }
+
+    ofSetColor(255, 0, 0);
+    ofDrawBitmapString("FrameRate: " + ofToString(ofGetFrameRate()), x, y);
+    for(int s=0; s<NUM_STAGES; s++){
+        double average = count[s] > 0 ? total[s] / count[s] : 0;
+        string line = getStageName((Stage)s) + ": " + ofToString(average, 2) + " ms avg, " + ofToString(worst[s], 2) + " ms max, " + ofToString(count[s]) + "/s";
+        ofDrawBitmapString(line, x, y + (s + 1) * 12);
+    }
+    ofSetColor(255);
+}
+
+//--------------------------------------------------------------
+bool Profiler::saveCsv(string path){
+
+    vector<Sample> samples;
+    collect(samples);
+
+    ofstream file(ofToDataPath(path).c_str());
+    if(!file)
+    {
+        ofLogError("Profiler") << "Could not write " << path;
+        return false;
+    }
+
+    file << "stage,thread,start_us,duration_us\n";
+    for(size_t i=0; i<samples.size(); i++){
+        file << getStageName((Stage)samples[i].stage) << "," << samples[i].thread << "," << samples[i].start << "," << samples[i].end - samples[i].start << "\n";
+    }
+
+    ofLogNotice("Profiler") << "Saved " << samples.size() << " records to " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+/* The Trace Event format, every record is a complete event on its thread's row */
+bool Profiler::saveChromeTrace(string path){
+
+    vector<Sample> samples;
+    collect(samples);
+
+    ofstream file(ofToDataPath(path).c_str());
+    if(!file)
+    {
+        ofLogError("Profiler") << "Could not write " << path;
+        return false;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    for(size_t i=0; i<samples.size(); i++){
+        file << "{\"name\":\"" << getStageName((Stage)samples[i].stage) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << samples[i].thread
+             << ",\"ts\":" << samples[i].start << ",\"dur\":" << samples[i].end - samples[i].start << "}";
+        file << (i + 1 < samples.size() ? ",\n" : "\n");
+    }
+    file << "]}\n";
+
+    ofLogNotice("Profiler") << "Saved " << samples.size() << " records to " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+string Profiler::getStageName(Stage stage){
+    switch(stage){
+        case FLOW_FETCH: return "flow fetch";
+        case REPULSION_PASS: return "repulsion pass";
+        case NETWORK_PASS: return "network pass";
+        case FORCE_PASS: return "force pass";
+        case RESET_PASS: return "reset pass";
+        case MESH_UPDATE: return "mesh update";
+        case FBO_DRAW: return "fbo draw";
+        case CHECKPOINT: return "checkpoint";
+        case CAPTURE: return "capture";
+        case CONVERT: return "convert";
+        case FLOW: return "flow";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,106 @@
+//
+//  Profiler.h
+//
+//
+
+/* -Times the different stages of each frame, on every thread, so when an installation drops
+ *  frames we can see if it is the camera, the flow, the physics or the drawing.
+ *
+ * -Put a ProfileScope at the top of a block and it records how long the block took. Records
+ *  go into a fixed size ring that any thread can write to without a lock, the oldest ones
+ *  get overwritten.
+ *
+ * -The main thread can draw an overlay of the recent timings or save the ring as CSV or as a
+ *  Chrome trace (open chrome://tracing and load the file).
+ */
+
+#pragma once
+
+/* Includes */
+#include "ofMain.h"
+#include <atomic>
+
+class Profiler {
+
+public:
+
+    /* Everything we time */
+    enum Stage {
+        FLOW_FETCH,
+        REPULSION_PASS,
+        NETWORK_PASS,
+        FORCE_PASS,
+        RESET_PASS,
+        MESH_UPDATE,
+        FBO_DRAW,
+        CHECKPOINT,
+        CAPTURE,
+        CONVERT,
+        FLOW,
+        NUM_STAGES
+    };
+
+    /* There is only one profiler, shared by every thread */
+    static Profiler& get();
+
+    /* Add a record, safe to call from any thread */
+    void record(Stage stage, uint64_t start, uint64_t end);
+
+    /* Main thread only */
+    void drawOverlay(float x, float y);
+    bool saveCsv(string path);
+    bool saveChromeTrace(string path);
+
+    static string getStageName(Stage stage);
+
+    /* A copy of one record */
+    struct Sample {
+        int stage, thread;
+        uint64_t start, end;
+    };
+
+    /* Copy out every complete record, oldest first */
+    void collect(vector<Sample> &out);
+
+private:
+
+    Profiler();
+
+    /* One timing, sequence is cleared while writing and set last, so a reader can tell if the
+     * slot is complete and wasn't overwritten while it was reading it
+     */
+    struct Record {
+        std::atomic<uint64_t> sequence;
+        std::atomic<int> stage, thread;
+        std::atomic<uint64_t> start, end;
+    };
+
+    static const int RING_SIZE = 16384;
+    Record ring[RING_SIZE];
+    std::atomic<uint64_t> head;
+    std::atomic<int> numThreads;
+
+    /* Gives each thread a small number for the trace */
+    int getThreadIndex();
+};
+
+//--------------------------------------------------------------
+/* Records how long the enclosing block took */
+class ProfileScope {
+
+public:
+
+    ProfileScope(Profiler::Stage _stage) {
+        stage = _stage;
+        start = ofGetElapsedTimeMicros();
+    }
+
+    ~ProfileScope() {
+        Profiler::get().record(stage, start, ofGetElapsedTimeMicros());
+    }
+
+private:
+
+    Profiler::Stage stage;
+    uint64_t start;
+};
@@ -0,0 +1,29 @@
+//
+//  Simd.h
+//
+//
+
+#ifndef Simd_h
+#define Simd_h
+
+/* SSE and AVX2 are only available on x86, everything else uses the scalar paths. Which one a
+ * CPU actually has is checked at runtime with ParticleKernel::getBestBackend()
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+/* GCC and Clang need to be told which functions may use which instruction set, MSVC does not */
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET_SSE __attribute__((target("sse2")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_SSE
+#define SIMD_TARGET_AVX2
+#endif
+
+#endif /* Simd_h */
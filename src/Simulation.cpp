@@ -0,0 +1,489 @@
+//
+//  Simulation.cpp
+//
+//
+
+#include "Simulation.h"
+#include "Profiler.h"
+#include "ParticleConstants.h"
+
+//--------------------------------------------------------------
+Simulation::Simulation(){
+    pool = NULL;
+    gravity.set(0, ParticleConstants::gravity);
+    resetParticles = false;
+    resetPercent = 0;
+    freeParticleCount = 0;
+    repulsionRadius = 0;
+    repulsionStrength = 0;
+    networkStiffness = 0;
+    gridSize = 0;
+    substeps = 1;
+    flowSampling = FlowField::NEAREST;
+    sleepSpeed = 0;
+    wakeFlow = 0.1;
+    sleepTicks = 30;
+    awakeTileCount = 0;
+    flowBlocksW = 0;
+    flowBlocksH = 0;
+    flowBlocksSequence = 0;
+}
+
+//--------------------------------------------------------------
+void Simulation::setup(float width, float height, int _gridSize, WorkerPool *_pool){
+
+    pool = _pool;
+    gridSize = _gridSize;
+
+    /* Variables for drawing a grid */
+    float xStep = width / gridSize;
+    float yStep = height / gridSize;
+    float offSetX = xStep / 2;
+    float offSetY = yStep / 2;
+    float radius = 1;
+
+    /* The particles bounce off the edges, reserve space so nothing reallocates */
+    particles.clear();
+    particles.setBounds(width, height);
+    particles.reserve(gridSize * gridSize);
+    gridIndex.assign(gridSize * gridSize, 0);
+
+    /* Which grid tile each particle was made in, for the sleeping tiles' bounds */
+    vector<int> particleGridTile;
+    particleGridTile.reserve(gridSize * gridSize);
+    int numGridTiles = 0;
+
+    /* Nested loop for creating my particles in a grid. They are added a tile at a time, row by
+     * row inside each tile, so particles next to each other in the arrays read flow pixels that
+     * are next to each other in memory
+     */
+    for(int tileY=0; tileY<gridSize; tileY+=PARTICLE_TILE_SIZE){
+        for(int tileX=0; tileX<gridSize; tileX+=PARTICLE_TILE_SIZE){
+            for(int j=tileY; j<MIN(tileY + PARTICLE_TILE_SIZE, gridSize); j++){
+                for(int i=tileX; i<MIN(tileX + PARTICLE_TILE_SIZE, gridSize); i++){
+                    /* Vector to store points and then calculate the positions */
+                    ofVec2f p;
+                    p.x = xStep * i + offSetX;
+                    p.y = yStep * j + offSetY;
+
+                    /* Add a particle, this just adds an entry to each array in the particle system */
+                    gridIndex[j * gridSize + i] = particles.addParticle(p, radius);
+                    particleGridTile.push_back(numGridTiles);
+                }
+            }
+            numGridTiles++;
+        }
+    }
+
+    /* Calculate 50% of the total number of particles */
+    resetPercent = particles.size() * 0.5;
+    resetParticles = false;
+
+    /* The grid for the repulsion covers the same area as the particles */
+    setRepulsion(repulsionRadius, repulsionStrength);
+    setNetwork(networkStiffness);
+
+    /* Every tile starts awake. Its boxes are around its particles' origins, a new one starts
+     * wherever the particles go on to the next grid tile
+     */
+    int numTiles = (particles.size() + PARTICLES_PER_TILE - 1) / PARTICLES_PER_TILE;
+    tileAwake.assign(numTiles, 1);
+    tileQuietTicks.assign(numTiles, 0);
+    tileBoxBegin.assign(numTiles + 1, 0);
+    boxMinX.clear();
+    boxMinY.clear();
+    boxMaxX.clear();
+    boxMaxY.clear();
+    for(int i=0; i<particles.size(); i++){
+        if(i % PARTICLES_PER_TILE == 0 || particleGridTile[i] != particleGridTile[i - 1])
+        {
+            boxMinX.push_back(width);
+            boxMinY.push_back(height);
+            boxMaxX.push_back(0);
+            boxMaxY.push_back(0);
+        }
+        int b = boxMinX.size() - 1;
+        boxMinX[b] = MIN(boxMinX[b], particles.originX[i]);
+        boxMinY[b] = MIN(boxMinY[b], particles.originY[i]);
+        boxMaxX[b] = MAX(boxMaxX[b], particles.originX[i]);
+        boxMaxY[b] = MAX(boxMaxY[b], particles.originY[i]);
+        tileBoxBegin[i / PARTICLES_PER_TILE + 1] = boxMinX.size();
+    }
+    awakeTileCount = numTiles;
+
+    /* No box should be more than 8x8 points of the grid, or sleeping tiles would check the flow
+     * over far more of the screen than their particles cover
+     */
+    int oversizedBoxes = 0;
+    for(size_t b=0; b<boxMinX.size(); b++){
+        if(boxMaxX[b] - boxMinX[b] > (PARTICLE_TILE_SIZE - 0.5) * xStep || boxMaxY[b] - boxMinY[b] > (PARTICLE_TILE_SIZE - 0.5) * yStep)
+        {
+            oversizedBoxes++;
+        }
+    }
+    if(oversizedBoxes > 0)
+    {
+        ofLogError("Simulation") << oversizedBoxes << " sleeping tile bounds are bigger than " << PARTICLE_TILE_SIZE << "x" << PARTICLE_TILE_SIZE << " points of the grid";
+    }
+    flowBlocksSequence = 0;
+
+    /* Check the vectorized kernel gives the same result as the scalar path on this CPU */
+    float kernelError = kernel.validate(particles, gravity);
+    ofLogNotice("Simulation") << "Particle kernel: " << kernel.getBackendName() << ", max error against scalar: " << kernelError;
+    if(kernelError > 0.001)
+    {
+        ofLogWarning("Simulation") << "Particle kernel is out of tolerance, falling back to scalar";
+        kernel.setBackend(ParticleKernel::SCALAR);
+    }
+
+    /* And that the springs still pull like the original ones did */
+    float springError = kernel.validateSprings(particles);
+    ofLogNotice("Simulation") << "Spring force: max error against the original spring: " << springError;
+    if(springError > 0.0001)
+    {
+        ofLogWarning("Simulation") << "Spring force is out of tolerance, falling back to scalar";
+        kernel.setBackend(ParticleKernel::SCALAR);
+    }
+}
+
+//--------------------------------------------------------------
+void Simulation::step(const FlowFrame &frame){
+
+    /* Every chunk counts its own free particles, they get added up in chunk order afterwards */
+    int numParticles = particles.size();
+    chunkFreeCounts.assign(WorkerPool::getNumChunks(numParticles, PARTICLE_CHUNK_SIZE), 0);
+    chunkAwakeCounts.assign(chunkFreeCounts.size(), 0);
+    float wakeFlowSquared = wakeFlow * wakeFlow;
+
+    /* Flow frames are numbered from one, so the first frame is always new */
+    if(sleepSpeed > 0 && frame.sequence != flowBlocksSequence)
+    {
+        frame.field.getBlockMaxLengthSquared(FLOW_BLOCK_SIZE, flowBlocks, flowBlocksW, flowBlocksH);
+        flowBlocksSequence = frame.sequence;
+    }
+
+    /* Work out how much the free particles push each other before anything moves. Every
+     * particle only writes its own push, so the chunks don't need to lock anything
+     */
+    if(repulsionRadius > 0)
+    {
+        ProfileScope scope(Profiler::REPULSION_PASS);
+        hash.build(particles);
+        pool->parallelFor(numParticles, PARTICLE_CHUNK_SIZE, [&](int begin, int end, int chunk){
+            for(int i=begin; i<end; i++){
+                addRepulsion(i);
+            }
+        });
+    }
+
+    /* The network springs pull on top of that. They also only read the positions, and each
+     * particle's row only has its own springs in it. A stretched grid that has settled still
+     * pulls hard on every particle, but the origin springs and gravity balance it. So a sleeping
+     * tile only wakes up when the force left over after all three is more than networkWakeForce
+     */
+    if(!network.isEmpty())
+    {
+        ProfileScope scope(Profiler::NETWORK_PASS);
+        float wakeForceSquared = ParticleConstants::networkWakeForce * ParticleConstants::networkWakeForce;
+        pool->parallelFor(numParticles, PARTICLE_CHUNK_SIZE, [&](int begin, int end, int chunk){
+            if(repulsionRadius <= 0)
+            {
+                std::fill(particles.repelX.begin() + begin, particles.repelX.begin() + end, 0.0f);
+                std::fill(particles.repelY.begin() + begin, particles.repelY.begin() + end, 0.0f);
+            }
+            network.addForces(particles, begin, end, particles.repelX.data(), particles.repelY.data());
+
+            if(sleepSpeed > 0)
+            {
+                for(int i=begin; i<end; i++){
+                    int t = i / PARTICLES_PER_TILE;
+                    if(!tileAwake[t] && getNetForceSquared(i) > wakeForceSquared)
+                    {
+                        tileAwake[t] = 1;
+                        tileQuietTicks[t] = 0;
+                    }
+                }
+            }
+        });
+    }
+
+    /* Split the particles into chunks and update them on every core */
+    uint64_t forceStart = ofGetElapsedTimeMicros();
+    pool->parallelFor(numParticles, PARTICLE_CHUNK_SIZE, [&](int begin, int end, int chunk){
+
+        int firstTile = begin / PARTICLES_PER_TILE;
+        int lastTile = (end + PARTICLES_PER_TILE - 1) / PARTICLES_PER_TILE;
+
+        /* Wake any sleeping tile the flow has picked up under */
+        if(sleepSpeed > 0)
+        {
+            for(int t=firstTile; t<lastTile; t++){
+                if(!tileAwake[t] && getTileFlow(t, frame) > wakeFlowSquared)
+                {
+                    tileAwake[t] = 1;
+                    tileQuietTicks[t] = 0;
+                }
+            }
+        }
+
+        forEachAwakeRun(begin, end, [&](int runBegin, int runEnd){
+
+            /* Remember where the particles were so they can be drawn in between this tick and the next */
+            std::copy(particles.posX.begin() + runBegin, particles.posX.begin() + runEnd, particles.prevX.begin() + runBegin);
+            std::copy(particles.posY.begin() + runBegin, particles.posY.begin() + runEnd, particles.prevY.begin() + runBegin);
+
+            /* Read the optical flow force for the whole run at once and reverse the direction */
+            frame.field.sample(particles.posX.data() + runBegin, particles.posY.data() + runBegin, runEnd - runBegin,
+                               particles.cvForceX.data() + runBegin, particles.cvForceY.data() + runBegin, flowSampling,
+                               kernel.getBackend(), ParticleConstants::flowGain);
+
+            /* Update the run in one go, adds gravity and the flow force, dampens and integrates. The
+             * flow stays the same for every substep of the tick
+             */
+            for(int s=0; s<substeps; s++){
+                kernel.update(particles, runBegin, runEnd, gravity);
+            }
+        });
+
+        /* Put the tiles that have been still for long enough to sleep */
+        int awake = 0;
+        for(int t=firstTile; t<lastTile; t++){
+            if(sleepSpeed > 0 && tileAwake[t])
+            {
+                tileQuietTicks[t] = isTileQuiet(t) && getTileFlow(t, frame) <= wakeFlowSquared ? tileQuietTicks[t] + 1 : 0;
+                if(tileQuietTicks[t] >= sleepTicks)
+                {
+                    sleepTile(t);
+                }
+            }
+            awake += tileAwake[t];
+        }
+        chunkAwakeCounts[chunk] = awake;
+
+        /* Here I am counting how many particles are free from the spring, a word of 64 at a time */
+        chunkFreeCounts[chunk] = particles.countFree(begin, end);
+    });
+    Profiler::get().record(Profiler::FORCE_PASS, forceStart, ofGetElapsedTimeMicros());
+
+    /* Add up the free particles, always in the same order so the result never changes */
+    freeParticleCount = 0;
+    awakeTileCount = 0;
+    for(size_t c=0; c<chunkFreeCounts.size(); c++){
+        freeParticleCount += chunkFreeCounts[c];
+        awakeTileCount += chunkAwakeCounts[c];
+    }
+
+    /* If the value is over a certian percentage then it sets a varibale to true */
+    if(freeParticleCount > resetPercent)
+    {
+        resetParticles = true;
+    }
+
+    /* Move every free particle on through its lifecycle, not just the ones above freeParticleCount.
+     * Attached particles are skipped 64 at a time and each chunk only touches its own words, so
+     * this can be split up too
+     */
+    if(resetParticles)
+    {
+        ProfileScope scope(Profiler::RESET_PASS);
+        pool->parallelFor(numParticles, PARTICLE_CHUNK_SIZE, [&](int begin, int end, int chunk){
+            particles.resetRange(begin, end);
+        });
+    }
+}
+
+//--------------------------------------------------------------
+void Simulation::setRepulsion(float radius, float strength){
+    repulsionRadius = MAX(radius, 0.0f);
+    repulsionStrength = strength;
+
+    /* Cells as big as the radius, so a query never has to look further than the next cell */
+    if(repulsionRadius > 0)
+    {
+        hash.setup(particles.width, particles.height, repulsionRadius);
+    }
+}
+
+//--------------------------------------------------------------
+void Simulation::setNetwork(float stiffness){
+    networkStiffness = stiffness;
+
+    /* Nothing to join until there is a grid */
+    if(gridSize == 0)
+    {
+        return;
+    }
+    network.build(particles, gridIndex, gridSize, networkStiffness);
+    particles.neighbourForces = !network.isEmpty();
+
+    /* Don't leave the network's last pull behind for the repulsion or the kernels to read */
+    std::fill(particles.repelX.begin(), particles.repelX.end(), 0.0f);
+    std::fill(particles.repelY.begin(), particles.repelY.end(), 0.0f);
+
+    if(!network.isEmpty())
+    {
+        ofLogNotice("Simulation") << "Spring network: " << network.getNumSprings() << " springs";
+    }
+}
+
+//--------------------------------------------------------------
+void Simulation::setSleep(float speed, float _wakeFlow){
+    sleepSpeed = MAX(speed, 0.0f);
+    wakeFlow = _wakeFlow;
+
+    /* Turning it off wakes everything up */
+    if(sleepSpeed == 0)
+    {
+        tileAwake.assign(tileAwake.size(), 1);
+        tileQuietTicks.assign(tileQuietTicks.size(), 0);
+    }
+}
+
+//--------------------------------------------------------------
+/* A tile can sleep when every particle in it is attached to its spring and nearly still */
+bool Simulation::isTileQuiet(int tile){
+
+    /* A tile is one lifecycle word, so one look tells us if any of them are free */
+    if(particles.freeBits[tile] != 0)
+    {
+        return false;
+    }
+
+    int begin = tile * PARTICLES_PER_TILE;
+    int end = MIN(begin + PARTICLES_PER_TILE, particles.size());
+    float speedSquared = sleepSpeed * sleepSpeed;
+    for(int i=begin; i<end; i++){
+        /* A spring that broke this tick only shows up in freeBits on the next one */
+        if(!particles.getDoSpring(i) || particles.velX[i] * particles.velX[i] + particles.velY[i] * particles.velY[i] > speedSquared)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+/* The longest flow under a tile squared, from the blocks around each of its boxes. The margin
+ * covers how far a sleeping particle can sit from its origin and the pixel next to it that
+ * bilinear reads
+ */
+float Simulation::getTileFlow(int tile, const FlowFrame &frame){
+    float scale = frame.field.scale;
+    float most = 0;
+    for(int b=tileBoxBegin[tile]; b<tileBoxBegin[tile + 1]; b++){
+        int x0 = MAX(0, (int)(boxMinX[b] * scale) - 2) / FLOW_BLOCK_SIZE;
+        int y0 = MAX(0, (int)(boxMinY[b] * scale) - 2) / FLOW_BLOCK_SIZE;
+        int x1 = MIN(flowBlocksW - 1, ((int)(boxMaxX[b] * scale) + 2) / FLOW_BLOCK_SIZE);
+        int y1 = MIN(flowBlocksH - 1, ((int)(boxMaxY[b] * scale) + 2) / FLOW_BLOCK_SIZE);
+
+        for(int y=y0; y<=y1; y++){
+            for(int x=x0; x<=x1; x++){
+                most = MAX(most, flowBlocks[y * flowBlocksW + x]);
+            }
+        }
+    }
+    return most;
+}
+
+//--------------------------------------------------------------
+/* The network pull on an attached particle plus its origin spring and gravity, the same spring
+ * maths as ParticleSystem::calcSpring. Only used for particles in sleeping tiles, which are all
+ * attached and still, so there is no damping or flow to add
+ */
+float Simulation::getNetForceSquared(int i){
+    float dx = particles.posX[i] - particles.originX[i];
+    float dy = particles.posY[i] - particles.originY[i];
+    float k = particles.springStiffness;
+    float d2 = dx * dx + dy * dy;
+    if(particles.springLength > 0 && d2 > 0)
+    {
+        k -= particles.springStiffness * particles.springLength / sqrtf(d2);
+    }
+    float fx = particles.repelX[i] + dx * k + gravity.x;
+    float fy = particles.repelY[i] + dy * k + gravity.y;
+    return fx * fx + fy * fy;
+}
+
+//--------------------------------------------------------------
+/* Stop the tile where it is, it will be drawn there until it wakes up */
+void Simulation::sleepTile(int tile){
+    int begin = tile * PARTICLES_PER_TILE;
+    int end = MIN(begin + PARTICLES_PER_TILE, particles.size());
+    for(int i=begin; i<end; i++){
+        particles.resetVelocity(i);
+        particles.prevX[i] = particles.posX[i];
+        particles.prevY[i] = particles.posY[i];
+    }
+    tileAwake[tile] = 0;
+    tileQuietTicks[tile] = 0;
+}
+
+//--------------------------------------------------------------
+/* The same push as Particle::repulsionParticle, but each particle adds up the push from all its
+ * neighbours instead of pushing both particles of a pair, so it can run on any thread
+ */
+void Simulation::addRepulsion(int i){
+    float fx = 0;
+    float fy = 0;
+
+    /* Attached particles are held by their springs, only the free ones get pushed around, and
+     * only by each other. Returning and settling ones stay at zero, settling particles are back on
+     * their springs and the vector kernels only read this for them when the network is on
+     */
+    if(particles.getLifecycle(i) == ParticleSystem::FREE)
+    {
+        float x = particles.posX[i];
+        float y = particles.posY[i];
+        hash.forEachNeighbor(x, y, repulsionRadius, [&](int j, float jx, float jy){
+            float dx = x - jx;
+            float dy = y - jy;
+            float length = sqrt(dx * dx + dy * dy);
+
+            /* This skips the particle itself too */
+            if(length > 0)
+            {
+                fx += dx / length * repulsionStrength;
+                fy += dy / length * repulsionStrength;
+            }
+        });
+    }
+
+    particles.repelX[i] = fx;
+    particles.repelY[i] = fy;
+}
+
+//--------------------------------------------------------------
+int Simulation::advance(const FlowFrame &frame, double elapsedSeconds){
+    int ticks = clock.advance(elapsedSeconds);
+    for(int t=0; t<ticks; t++){
+        step(frame);
+    }
+    return ticks;
+}
+
+//--------------------------------------------------------------
+void Simulation::setTimestep(int _substeps, string integratorName){
+    substeps = MAX(1, _substeps);
+
+    /* Time is in 60fps frames, so a tick is always 1 */
+    particles.dt = 1.0 / substeps;
+
+    if(integratorName == "position_verlet")
+    {
+        particles.integrator = ParticleSystem::POSITION_VERLET;
+    }
+    else if(integratorName == "velocity_verlet")
+    {
+        particles.integrator = ParticleSystem::VELOCITY_VERLET;
+    }
+    else
+    {
+        if(integratorName != "euler")
+        {
+            ofLogWarning("Simulation") << "Unknown integrator " << integratorName << ", using euler";
+        }
+        particles.integrator = ParticleSystem::SEMI_IMPLICIT_EULER;
+    }
+
+    ofLogNotice("Simulation") << "Physics: " << ParticleSystem::getIntegratorName(particles.integrator) << ", " << substeps << " substeps per tick";
+}
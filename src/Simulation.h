@@ -0,0 +1,153 @@
+//
+//  Simulation.h
+//
+//
+
+#ifndef Simulation_h
+#define Simulation_h
+
+/* Includes */
+#include "ofMain.h"
+#include "ParticleSystem.h"
+#include "ParticleKernel.h"
+#include "WorkerPool.h"
+#include "FlowFrame.h"
+#include "SpatialHash.h"
+#include "PhysicsClock.h"
+#include "SpringNetwork.h"
+
+/* How many particles each thread updates at a time, a multiple of 8 so AVX2 never has leftovers
+ * and of 64 so every chunk has lifecycle words of its own
+ */
+#define PARTICLE_CHUNK_SIZE 1024
+
+/* The grid is built in square tiles of this many particles a side, one AVX2 batch is one tile row */
+#define PARTICLE_TILE_SIZE 8
+
+/* Particles that sleep together, which is the size of a lifecycle word in the particle system. A
+ * full grid tile is exactly one of them. When the grid isn't a multiple of 8 the grid tiles at the
+ * right and bottom edges are smaller, and after one of those a sleeping tile holds the end of one
+ * grid tile and the start of the next. It keeps a box around its particles in each of them, never
+ * one box around both, since the two can be on opposite sides of the screen
+ */
+#define PARTICLES_PER_TILE 64
+
+/* Sleeping tiles check the flow in blocks of this many flow pixels a side */
+#define FLOW_BLOCK_SIZE 4
+
+/* This class is the physics part of the program on its own: the grid of particles, reading the
+ * optical flow, updating every particle and sending them back to the grid when too many are
+ * free. It doesn't need a window or a webcam, so the same code runs in the app and in the
+ * headless benchmark.
+ *
+ * The physics ticks 60 times a second whatever the frame rate is, see PhysicsClock. Each tick
+ * reads the flow once and can be split into substeps for stiffer springs.
+ *
+ * Most of the time people only move in front of a small part of the camera, and the rest of
+ * the grid sits still on its springs. With sleeping turned on, a tile whose particles have all
+ * been attached and nearly still for half a second stops being updated and drawn until the flow
+ * under it picks up again.
+*/
+
+class Simulation{
+public:
+    /* Constructor */
+    Simulation();
+
+    /* Make a gridSize by gridSize grid of particles filling width by height */
+    void setup(float width, float height, int _gridSize, WorkerPool *_pool);
+
+    /* One tick of physics driven by a frame of optical flow */
+    void step(const FlowFrame &frame);
+
+    /* Run as many ticks as are due after elapsedSeconds, returns how many ran */
+    int advance(const FlowFrame &frame, double elapsedSeconds);
+
+    /* Split every tick into substeps, integrated with euler, position_verlet or velocity_verlet */
+    void setTimestep(int _substeps, string integratorName);
+
+    /* Free particles push each other apart when they are closer than radius, zero turns it off */
+    void setRepulsion(float radius, float strength);
+
+    /* Join the particles to their neighbours with springs this stiff, like cloth, zero turns it off */
+    void setNetwork(float stiffness);
+
+    /* Tiles sleep once every particle in them has been slower than speed for sleepTicks ticks and
+     * wake when the flow under them is longer than wakeFlow. Zero speed turns it off
+     */
+    void setSleep(float speed, float _wakeFlow);
+
+    //--------------------------------------------------------------
+    /* Call f(runBegin, runEnd) for every run of awake tiles between begin and end, begin has to
+     * be on a tile. With sleeping off that is the whole range in one go
+     */
+    template<class F>
+    void forEachAwakeRun(int begin, int end, F f){
+        int runBegin = begin;
+        for(int b=begin; b<end; b+=PARTICLES_PER_TILE){
+            if(!tileAwake[b / PARTICLES_PER_TILE])
+            {
+                if(runBegin < b)
+                {
+                    f(runBegin, b);
+                }
+                runBegin = b + PARTICLES_PER_TILE;
+            }
+        }
+        if(runBegin < end)
+        {
+            f(runBegin, end);
+        }
+    }
+
+    /* Variables */
+    ParticleSystem particles;
+    ParticleKernel kernel;
+    WorkerPool *pool;
+    ofVec2f gravity;
+    PhysicsClock clock;
+    int substeps;
+
+    /* How the flow is read at each particle, nearest or bilinear */
+    FlowField::Sampling flowSampling;
+
+    /* Reset logic, resetParticles turns on once more than resetPercent particles are free */
+    bool resetParticles;
+    int resetPercent, freeParticleCount;
+    vector<int> chunkFreeCounts;
+
+    /* Finds the particles near each other for the repulsion */
+    SpatialHash hash;
+    float repulsionRadius, repulsionStrength;
+
+    /* The springs between neighbours, gridIndex has the particle at each point of the grid row by row */
+    SpringNetwork network;
+    float networkStiffness;
+    vector<int> gridIndex;
+    int gridSize;
+
+    /* Sleeping, one entry per tile. A tile has one box for each grid tile it has particles from,
+     * around the origins of just those particles, boxes tileBoxBegin[t] to tileBoxBegin[t + 1]. The
+     * tiles look the flow up in flowBlocks, the longest flow in each 4x4 block of flow pixels
+     * squared, which is worked out once per flow frame
+     */
+    float sleepSpeed, wakeFlow;
+    int sleepTicks, awakeTileCount;
+    vector<unsigned char> tileAwake;
+    vector<int> tileQuietTicks;
+    vector<int> tileBoxBegin;
+    vector<float> boxMinX, boxMinY, boxMaxX, boxMaxY;
+    vector<int> chunkAwakeCounts;
+    vector<float> flowBlocks;
+    int flowBlocksW, flowBlocksH;
+    unsigned long long flowBlocksSequence;
+
+private:
+    void addRepulsion(int i);
+    bool isTileQuiet(int tile);
+    float getTileFlow(int tile, const FlowFrame &frame);
+    void sleepTile(int tile);
+    float getNetForceSquared(int i);
+};
+
+#endif /* Simulation_h */
@@ -0,0 +1,49 @@
+//
+//  SimulationSnapshot.h
+//
+//
+
+/* -The file format Checkpointer saves the simulation in, so an installation that crashed can
+ *  carry on where it was, or start from a scene that was saved once it looked right.
+ *
+ * -A 64 byte header, then every array of the particle system one after another, then the
+ *  tiles and the spring network. Each array starts on a multiple of 64 bytes, so the file
+ *  can be mapped and every array copied straight out of it.
+ *
+ * -The arrays are in the order Checkpointer::getSections() lists them. Anything added to the
+ *  particle system has to go on the end of that list and the version has to go up.
+ *
+ * -A snapshot only fits the grid it was saved from, the same number of particles on a screen
+ *  of the same size. The network's springs are only kept if the network has the same number
+ *  of springs, otherwise it starts whole.
+ *
+ * -Everything is little endian, which is every machine we run on.
+ */
+
+#pragma once
+
+/* Includes */
+#include <cstdint>
+
+/* At the start of the file */
+struct SimulationSnapshotHeader {
+    char magic[8];          // "PSISNAP1"
+    uint32_t version;
+    uint32_t numParticles;
+    uint32_t gridSize;
+    uint32_t numSpringEnds; // Entries in the network's state array, zero without a network
+    float width, height;    // The screen the grid was laid out on
+    uint64_t totalTicks;    // Physics ticks run before the snapshot was taken
+    uint64_t fileBytes;     // Size of the whole file, a shorter file was cut off
+    uint32_t resetParticles;
+    char reserved[12];
+};
+static_assert(sizeof(SimulationSnapshotHeader) == 64, "The header must be 64 bytes");
+
+#define SIMULATION_SNAPSHOT_MAGIC "PSISNAP1"
+#define SIMULATION_SNAPSHOT_VERSION 1
+
+/* Where an array starts after one that ends at offset */
+inline uint64_t getSnapshotSectionOffset(uint64_t offset) {
+    return (offset + 63) & ~(uint64_t)63;
+}
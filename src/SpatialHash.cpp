@@ -0,0 +1,102 @@
+//
+//  SpatialHash.cpp
+//
+//
+
+#include "SpatialHash.h"
+
+//--------------------------------------------------------------
+SpatialHash::SpatialHash(){
+    width = 0;
+    height = 0;
+    cellSize = 1;
+    invCellSize = 1;
+    cols = 0;
+    rows = 0;
+}
+
+//--------------------------------------------------------------
+void SpatialHash::setup(float _width, float _height, float _cellSize){
+    width = _width;
+    height = _height;
+    cellSize = MAX(_cellSize, 1.0f);
+    invCellSize = 1.0 / cellSize;
+    cols = MAX(1, (int)ceil(width * invCellSize));
+    rows = MAX(1, (int)ceil(height * invCellSize));
+
+    /* Allocate the cells once, build() only refills them */
+    cellStart.assign(cols * rows + 1, 0);
+}
+
+//--------------------------------------------------------------
+int SpatialHash::getColumn(float x) const {
+    return MAX(0, MIN((int)(x * invCellSize), cols - 1));
+}
+
+//--------------------------------------------------------------
+int SpatialHash::getRow(float y) const {
+    return MAX(0, MIN((int)(y * invCellSize), rows - 1));
+}
+
+//--------------------------------------------------------------
+int SpatialHash::getCell(float x, float y) const {
+    return getRow(y) * cols + getColumn(x);
+}
+
+//--------------------------------------------------------------
+void SpatialHash::build(ParticleSystem &ps){
+
+    int numParticles = ps.size();
+    int numWords = (numParticles + 63) / 64;
+    int numCells = cols * rows;
+    particleCell.resize(numParticles);
+    sortedIndex.resize(numParticles);
+    sortedX.resize(numParticles);
+    sortedY.resize(numParticles);
+
+    /* Count how many free particles are in each cell, shifted by one so the sum below gives the
+     * starts. Only the lifecycle words with free particles in them are looked at
+     */
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    for(int w=0; w<numWords; w++){
+        for(uint64_t bits=ps.getLooseBits(w); bits!=0; bits&=bits - 1){
+            int i = w * 64 + ParticleSystem::lowestBit(bits);
+            int cell = getCell(ps.posX[i], ps.posY[i]);
+            particleCell[i] = cell;
+            cellStart[cell + 1]++;
+        }
+    }
+
+    /* Add the counts up so each cell knows where it starts */
+    for(int c=0; c<numCells; c++){
+        cellStart[c + 1] += cellStart[c];
+    }
+
+    /* Drop every particle into the next free slot of its cell, each start is used as the write
+     * position and moves up by one every time
+     */
+    for(int w=0; w<numWords; w++){
+        for(uint64_t bits=ps.getLooseBits(w); bits!=0; bits&=bits - 1){
+            int i = w * 64 + ParticleSystem::lowestBit(bits);
+            int slot = cellStart[particleCell[i]]++;
+            sortedIndex[slot] = i;
+            sortedX[slot] = ps.posX[i];
+            sortedY[slot] = ps.posY[i];
+        }
+    }
+
+    /* Every start moved up to the next cell's start while filling, shift them back */
+    for(int c=numCells; c>0; c--){
+        cellStart[c] = cellStart[c - 1];
+    }
+    cellStart[0] = 0;
+}
+
+//--------------------------------------------------------------
+int SpatialHash::query(float x, float y, float radius, vector<int> &out) const {
+    out.clear();
+    forEachNeighbor(x, y, radius, [&](int j, float jx, float jy){
+        out.push_back(j);
+    });
+    return out.size();
+}
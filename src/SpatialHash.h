@@ -0,0 +1,86 @@
+//
+//  SpatialHash.h
+//
+//
+
+#ifndef SpatialHash_h
+#define SpatialHash_h
+
+/* Includes */
+#include "ofMain.h"
+#include "ParticleSystem.h"
+
+/* A uniform grid over the free particles, rebuilt every frame, so a particle can find the particles
+ * near it without checking every other particle. With cells as big as the search radius only the
+ * 3x3 cells around a particle need checking, which keeps repulsion O(n) instead of O(n²).
+ *
+ * build() is a counting sort: count the particles in each cell, add the counts up to get where
+ * each cell starts, then drop every particle into its slot. The positions are copied into the
+ * sorted order too, so a query reads one contiguous run per cell row.
+*/
+
+class SpatialHash{
+public:
+    /* Constructor */
+    SpatialHash();
+
+    /* Cover width by height with square cells, cellSize should be at least the query radius */
+    void setup(float _width, float _height, float _cellSize);
+
+    /* Sort every particle that is FREE into its cell, the attached ones sit on the grid and the
+     * returning ones are on their way back, so neither of them are in the hash
+     */
+    void build(ParticleSystem &ps);
+
+    /* Which cell a position is in, positions outside the area go in the nearest edge cell */
+    int getCell(float x, float y) const;
+
+    /* Calls f(j, x, y) for every particle j within radius of x, y, including the particle at x, y itself.
+     * Only reads the grid, so any number of threads can query at once
+     */
+    template<typename F>
+    void forEachNeighbor(float x, float y, float radius, F f) const {
+        int col = getColumn(x);
+        int row = getRow(y);
+        int colMin = MAX(col - 1, 0);
+        int colMax = MIN(col + 1, cols - 1);
+        int rowMin = MAX(row - 1, 0);
+        int rowMax = MIN(row + 1, rows - 1);
+        float radiusSq = radius * radius;
+
+        for(int r=rowMin; r<=rowMax; r++){
+            /* The cells in a row are next to each other in the sorted arrays */
+            int begin = cellStart[r * cols + colMin];
+            int end = cellStart[r * cols + colMax + 1];
+            for(int k=begin; k<end; k++){
+                float dx = sortedX[k] - x;
+                float dy = sortedY[k] - y;
+                if(dx * dx + dy * dy < radiusSq)
+                {
+                    f(sortedIndex[k], sortedX[k], sortedY[k]);
+                }
+            }
+        }
+    }
+
+    /* Fills out with the particles within radius of x, y and returns how many there were */
+    int query(float x, float y, float radius, vector<int> &out) const;
+
+    /* Variables */
+    float width, height, cellSize, invCellSize;
+    int cols, rows;
+
+    /* cellStart has one extra entry at the end, cell c holds sortedIndex[cellStart[c]] to sortedIndex[cellStart[c + 1]] */
+    vector<int> cellStart;
+    vector<int> sortedIndex;
+    vector<float> sortedX, sortedY;
+
+    /* The cell each particle went in, in particle order, only set for the particles in the hash */
+    vector<int> particleCell;
+
+private:
+    int getColumn(float x) const;
+    int getRow(float y) const;
+};
+
+#endif /* SpatialHash_h */
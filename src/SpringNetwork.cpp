@@ -0,0 +1,153 @@
+//
+//  SpringNetwork.cpp
+//
+//
+
+#include "SpringNetwork.h"
+#include "ParticleConstants.h"
+
+/* The flags both ends need before a torn spring joins up again */
+static const unsigned char ATTACHED = ParticleSystem::DO_PHYSICS | ParticleSystem::DO_SPRING;
+
+/* The grid offsets of each type of spring, the rows are built in this order */
+static const int NUM_OFFSETS = 12;
+static const int OFFSETS[NUM_OFFSETS][3] = {
+    {0, -1, SpringNetwork::STRUCTURAL}, {-1, 0, SpringNetwork::STRUCTURAL}, {1, 0, SpringNetwork::STRUCTURAL}, {0, 1, SpringNetwork::STRUCTURAL},
+    {-1, -1, SpringNetwork::SHEAR}, {1, -1, SpringNetwork::SHEAR}, {-1, 1, SpringNetwork::SHEAR}, {1, 1, SpringNetwork::SHEAR},
+    {0, -2, SpringNetwork::BEND}, {-2, 0, SpringNetwork::BEND}, {2, 0, SpringNetwork::BEND}, {0, 2, SpringNetwork::BEND}
+};
+
+//--------------------------------------------------------------
+SpringNetwork::SpringNetwork(){
+    typeStiffness[STRUCTURAL] = 0;
+    typeStiffness[SHEAR] = 0;
+    typeStiffness[BEND] = 0;
+}
+
+//--------------------------------------------------------------
+void SpringNetwork::build(const ParticleSystem &ps, const vector<int> &gridIndex, int gridSize, float stiffness){
+    clear();
+    if(stiffness == 0)
+    {
+        return;
+    }
+
+    typeStiffness[STRUCTURAL] = stiffness;
+    typeStiffness[SHEAR] = stiffness * ParticleConstants::networkShear;
+    typeStiffness[BEND] = stiffness * ParticleConstants::networkBend;
+
+    /* Find each particle's place on the grid so the rows can be built in particle order */
+    int numParticles = gridSize * gridSize;
+    vector<int> gridX(numParticles), gridY(numParticles);
+    for(int y=0; y<gridSize; y++){
+        for(int x=0; x<gridSize; x++){
+            gridX[gridIndex[y * gridSize + x]] = x;
+            gridY[gridIndex[y * gridSize + x]] = y;
+        }
+    }
+
+    rowStart.reserve(numParticles + 1);
+    other.reserve(numParticles * NUM_OFFSETS);
+    restLength.reserve(numParticles * NUM_OFFSETS);
+    state.reserve(numParticles * NUM_OFFSETS);
+
+    /* The rest length is how far apart the origins are, so the grid starts without any force */
+    for(int i=0; i<numParticles; i++){
+        rowStart.push_back(other.size());
+        for(int o=0; o<NUM_OFFSETS; o++){
+            int x = gridX[i] + OFFSETS[o][0];
+            int y = gridY[i] + OFFSETS[o][1];
+            if(x < 0 || y < 0 || x >= gridSize || y >= gridSize)
+            {
+                continue;
+            }
+            int j = gridIndex[y * gridSize + x];
+            other.push_back(j);
+            restLength.push_back(ofDist(ps.originX[i], ps.originY[i], ps.originX[j], ps.originY[j]));
+            state.push_back(OFFSETS[o][2]);
+        }
+    }
+    rowStart.push_back(other.size());
+}
+
+//--------------------------------------------------------------
+void SpringNetwork::clear(){
+    rowStart.clear();
+    other.clear();
+    restLength.clear();
+    state.clear();
+}
+
+//--------------------------------------------------------------
+/* The same spring maths as ParticleSystem::calcSpring, with the rest length of each spring */
+void SpringNetwork::addForces(const ParticleSystem &ps, int begin, int end, float *outX, float *outY){
+
+    const float breakRatioSquared = ParticleConstants::networkBreakRatio * ParticleConstants::networkBreakRatio;
+    const float joinRatioSquared = ParticleConstants::networkJoinRatio * ParticleConstants::networkJoinRatio;
+
+    for(int i=begin; i<end; i++){
+        float x = ps.posX[i];
+        float y = ps.posY[i];
+        bool attached = (ps.flags[i] & ATTACHED) == ATTACHED;
+        float fx = 0;
+        float fy = 0;
+
+        for(int e=rowStart[i]; e<rowStart[i + 1]; e++){
+            int j = other[e];
+            float dx = x - ps.posX[j];
+            float dy = y - ps.posY[j];
+            float d2 = dx * dx + dy * dy;
+            float rest = restLength[e];
+            float rest2 = rest * rest;
+
+            if(state[e] & BROKEN)
+            {
+                /* Join up again once both ends are back on the grid, the force starts next tick */
+                if(attached && (ps.flags[j] & ATTACHED) == ATTACHED && d2 <= rest2 * joinRatioSquared)
+                {
+                    state[e] &= ~BROKEN;
+                }
+                continue;
+            }
+
+            /* Tear if it is stretched too far */
+            if(d2 > rest2 * breakRatioSquared)
+            {
+                state[e] |= BROKEN;
+                continue;
+            }
+
+            /* Two particles on top of each other don't know which way to push */
+            if(d2 > 0)
+            {
+                float stiffness = typeStiffness[state[e] & TYPE_MASK];
+                float k = stiffness - stiffness * rest / sqrtf(d2);
+                fx += dx * k;
+                fy += dy * k;
+            }
+        }
+
+        outX[i] += fx;
+        outY[i] += fy;
+    }
+}
+
+//--------------------------------------------------------------
+bool SpringNetwork::isEmpty(){
+    return other.empty();
+}
+
+//--------------------------------------------------------------
+/* Each spring is in two rows */
+int SpringNetwork::getNumSprings(){
+    return other.size() / 2;
+}
+
+//--------------------------------------------------------------
+int SpringNetwork::countBroken(){
+    int broken = 0;
+    for(size_t e=0; e<state.size(); e++){
+        broken += (state[e] & BROKEN) != 0;
+    }
+    return broken / 2;
+}
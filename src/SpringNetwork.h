@@ -0,0 +1,72 @@
+//
+//  SpringNetwork.h
+//
+//
+
+#ifndef SpringNetwork_h
+#define SpringNetwork_h
+
+/* Includes */
+#include "ofMain.h"
+#include "ParticleSystem.h"
+
+/* Springs between the particles of the grid, like a piece of cloth. Every particle is joined to
+ * the ones next to it (structural), on the diagonals (shear) and two along (bend), on top of the
+ * spring to its origin. Pulling on one part of the grid drags the rest along with it, and a
+ * spring stretched to breakRatio times its rest length tears. Torn springs join up again once
+ * both ends are back on their origin springs and close to their rest length.
+ *
+ * The springs are kept in compressed sparse rows: the springs of particle i are entries
+ * rowStart[i] to rowStart[i + 1] of the other arrays, and each spring is in the rows of both of
+ * its particles. That works every spring out twice, but a particle only ever adds to its own
+ * force, so a chunk of particles needs no locks and the rows are read front to back in the same
+ * order as the particles. Both copies of a spring see the same positions and get the same
+ * length, so they always break and join together.
+*/
+
+class SpringNetwork{
+public:
+    /* Constructor */
+    SpringNetwork();
+
+    /* Join every particle of a gridSize by gridSize grid to its neighbours, gridIndex has the
+     * particle index of each grid point row by row. Stiffness is for the structural springs,
+     * negative like the origin springs, zero means no network
+     */
+    void build(const ParticleSystem &ps, const vector<int> &gridIndex, int gridSize, float stiffness);
+    void clear();
+
+    /* Add the spring forces on particles begin to end to outX/outY and break or join their
+     * springs. It only reads the positions, so it has to run before any of them move
+     */
+    void addForces(const ParticleSystem &ps, int begin, int end, float *outX, float *outY);
+
+    /* Getters */
+    bool isEmpty();
+    int getNumSprings();
+    int countBroken();
+
+    /* What a spring joins, the low bits of state */
+    enum SpringType {
+        STRUCTURAL,
+        SHEAR,
+        BEND,
+        TYPE_MASK = 3,
+        BROKEN = 1 << 2
+    };
+
+    /* The rows, one entry per particle and one more at the end */
+    vector<int> rowStart;
+
+    /* One entry per spring end: the particle at the other end, the rest length and the type and
+     * whether it is broken
+     */
+    vector<int> other;
+    vector<float> restLength;
+    vector<unsigned char> state;
+
+    /* Stiffness of each type */
+    float typeStiffness[3];
+};
+
+#endif /* SpringNetwork_h */
@@ -0,0 +1,109 @@
+//
+//  SyntheticFlow.cpp
+//
+//
+
+#include "SyntheticFlow.h"
+
+//--------------------------------------------------------------
+/* Far from the centre the falloffs get so small they turn into denormals, which are very slow
+ * to do maths with. Flow that small doesn't move a particle anyway, so make it zero
+ */
+static float flush(float falloff){
+    return falloff < 1e-6 ? 0 : falloff;
+}
+
+//--------------------------------------------------------------
+SyntheticFlow::SyntheticFlow(){
+    width = 0;
+    height = 0;
+    scale = 1;
+    pattern = VORTEX;
+}
+
+//--------------------------------------------------------------
+void SyntheticFlow::setup(int _width, int _height, float _scale, Pattern _pattern){
+    width = _width;
+    height = _height;
+    scale = _scale;
+    pattern = _pattern;
+}
+
+//--------------------------------------------------------------
+void SyntheticFlow::update(FlowFrame &frame, int frameNum){
+
+    /* Make sure the frame is the right size */
+    if(frame.field.width != width || frame.field.height != height)
+    {
+        frame.field.allocate(width, height, scale);
+    }
+    frame.field.scale = scale;
+    frame.sequence = frameNum + 1;
+
+    float t = frameNum / 60.0;
+
+    for(int y=0; y<height; y++){
+        for(int x=0; x<width; x++){
+            int i = y * width + x;
+            float fx = 0;
+            float fy = 0;
+
+            if(pattern == VORTEX)
+            {
+                /* The centre moves in a circle, the swirl fades out away from it */
+                float cx = width * (0.5 + 0.3 * cos(t * 0.7));
+                float cy = height * (0.5 + 0.3 * sin(t * 0.9));
+                float dx = x - cx;
+                float dy = y - cy;
+                float falloff = flush(exp(-(dx * dx + dy * dy) / (2 * 30.0 * 30.0)));
+                fx = -dy * falloff;
+                fy = dx * falloff;
+            }
+            else if(pattern == SWEEP)
+            {
+                /* A band 20 pixels wide going back and forth */
+                float bandX = width * (0.5 + 0.5 * sin(t * 0.5));
+                float strength = flush(exp(-(x - bandX) * (x - bandX) / (2 * 10.0 * 10.0)));
+                fx = 40 * strength;
+                fy = 8 * strength * sin(y * 0.1);
+            }
+            else if(pattern == WAVE)
+            {
+                /* A blob moving side to side in the bottom left, pushing the way it moves */
+                float cx = width * (0.25 + 0.08 * sin(t * 4));
+                float cy = height * 0.7;
+                float dx = x - cx;
+                float dy = y - cy;
+                float falloff = flush(exp(-(dx * dx + dy * dy) / (2 * 8.0 * 8.0)));
+                fx = 6 * cos(t * 4) * falloff;
+                fy = 0;
+            }
+            else
+            {
+                /* Noise moving slowly through time */
+                fx = ofSignedNoise(x * 0.05, y * 0.05, t * 0.5) * 16;
+                fy = ofSignedNoise(x * 0.05 + 100, y * 0.05, t * 0.5) * 16;
+            }
+
+            frame.field.flowX[i] = fx;
+            frame.field.flowY[i] = fy;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+string SyntheticFlow::getPatternName(Pattern _pattern){
+    if(_pattern == VORTEX)
+    {
+        return "vortex";
+    }
+    else if(_pattern == SWEEP)
+    {
+        return "sweep";
+    }
+    else if(_pattern == WAVE)
+    {
+        return "wave";
+    }
+    return "noise";
+}
@@ -0,0 +1,44 @@
+//
+//  SyntheticFlow.h
+//
+//
+
+#ifndef SyntheticFlow_h
+#define SyntheticFlow_h
+
+/* Includes */
+#include "ofMain.h"
+#include "FlowFrame.h"
+
+/* Makes made up optical flow so the physics can be run without a webcam. Each pattern only
+ * depends on the frame number, so the same frame number always gives the same flow.
+*/
+
+class SyntheticFlow{
+public:
+    /* The different kinds of flow */
+    enum Pattern {
+        VORTEX, // A swirl that moves around the screen
+        SWEEP,  // A band of sideways motion that sweeps across, like someone walking past
+        NOISE,  // Smooth noise everywhere
+        WAVE    // A hand waving in one corner, the rest of the screen is still
+    };
+
+    /* Constructor */
+    SyntheticFlow();
+
+    /* The size of the flow, the same as openCvThread makes it */
+    void setup(int _width, int _height, float _scale, Pattern _pattern);
+
+    /* Fill in the flow for a frame */
+    void update(FlowFrame &frame, int frameNum);
+
+    static string getPatternName(Pattern _pattern);
+
+    /* Variables */
+    int width, height;
+    float scale;
+    Pattern pattern;
+};
+
+#endif /* SyntheticFlow_h */
@@ -0,0 +1,77 @@
+//
+//  TripleBuffer.h
+//
+//
+
+/* -A triple buffer for handing data from one thread to another without a lock.
+ *
+ * -The producer always writes into its own back buffer and then publishes it with one atomic
+ *  swap. The consumer swaps the newest published buffer in when it wants it. Neither side ever
+ *  waits for the other and the consumer never sees a half written buffer, it just skips any
+ *  frames that were published and replaced before it looked.
+ *
+ * -Only one thread may write and only one thread may read.
+ */
+
+#pragma once
+
+/* Includes */
+#include <atomic>
+
+template<class T>
+class TripleBuffer {
+
+public:
+
+    //--------------------------------------------------------------
+    TripleBuffer() {
+        /* The consumer starts with buffer 0, the middle is 1 and the producer writes to 2 */
+        front = 0;
+        middle = 1;
+        back = 2;
+    }
+
+    //--------------------------------------------------------------
+    /* Producer, the buffer to fill in before calling publish() */
+    T& getWriteBuffer() {
+        return buffers[back];
+    }
+
+    //--------------------------------------------------------------
+    /* Producer, hand the back buffer over and take the old middle buffer to write into next */
+    void publish() {
+        back = middle.exchange(back | NEW_DATA) & INDEX_MASK;
+    }
+
+    //--------------------------------------------------------------
+    /* Consumer, swap in the newest published buffer, returns false if there is nothing new */
+    bool fetch() {
+        if(!(middle.load() & NEW_DATA))
+        {
+            return false;
+        }
+        front = middle.exchange(front) & INDEX_MASK;
+        return true;
+    }
+
+    //--------------------------------------------------------------
+    /* Consumer, the buffer swapped in by the last fetch(), stays valid until the next one */
+    T& getReadBuffer() {
+        return buffers[front];
+    }
+
+    //--------------------------------------------------------------
+    /* Access to all three buffers, only use this before the producer thread has started */
+    T& getBuffer(int i) {
+        return buffers[i];
+    }
+
+private:
+
+    /* The middle index has a flag on it saying whether it has been published but not read yet */
+    enum { INDEX_MASK = 3, NEW_DATA = 4 };
+
+    T buffers[3];
+    int front, back;
+    std::atomic<int> middle;
+};
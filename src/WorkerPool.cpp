@@ -0,0 +1,166 @@
+//
+//  WorkerPool.cpp
+//
+//
+
+#include "WorkerPool.h"
+
+//--------------------------------------------------------------
+WorkerPool::WorkerPool(){
+    queues = NULL;
+    numThreads = 1;
+    job = NULL;
+    jobCount = 0;
+    jobChunkSize = 1;
+    jobNumChunks = 0;
+    chunksDone = 0;
+    generation = 0;
+    busyWorkers = 0;
+    stopping = false;
+}
+
+//--------------------------------------------------------------
+WorkerPool::~WorkerPool(){
+    stop();
+}
+
+//--------------------------------------------------------------
+void WorkerPool::setup(int _numThreads){
+
+    /* Stop any threads from a previous setup */
+    stop();
+
+    numThreads = _numThreads > 0 ? _numThreads : std::thread::hardware_concurrency();
+    numThreads = MAX(numThreads, 1);
+
+    /* One queue per thread, the calling thread is worker zero so we start one less thread */
+    queues = new ChunkQueue[numThreads];
+    for(int i=0; i<numThreads; i++){
+        queues[i].next = 0;
+        queues[i].end = 0;
+    }
+
+    stopping = false;
+    for(int i=1; i<numThreads; i++){
+        threads.push_back(std::thread(&WorkerPool::workerLoop, this, i, generation));
+    }
+}
+
+//--------------------------------------------------------------
+void WorkerPool::stop(){
+
+    /* Tell the threads to quit and wait for them */
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for(size_t i=0; i<threads.size(); i++){
+        threads[i].join();
+    }
+    threads.clear();
+
+    delete[] queues;
+    queues = NULL;
+    numThreads = 1;
+}
+
+//--------------------------------------------------------------
+int WorkerPool::getNumChunks(int count, int chunkSize){
+    return (count + chunkSize - 1) / chunkSize;
+}
+
+//--------------------------------------------------------------
+int WorkerPool::getNumThreads(){
+    return numThreads;
+}
+
+//--------------------------------------------------------------
+void WorkerPool::parallelFor(int count, int chunkSize, const Job &_job){
+
+    int numChunks = getNumChunks(count, chunkSize);
+
+    /* Not set up or nothing worth splitting, just run it here */
+    if(queues == NULL || numThreads == 1 || numChunks <= 1)
+    {
+        for(int c=0; c<numChunks; c++){
+            _job(c * chunkSize, MIN(count, (c + 1) * chunkSize), c);
+        }
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        /* Give every thread an equal share of the chunks to start with */
+        job = &_job;
+        jobCount = count;
+        jobChunkSize = chunkSize;
+        jobNumChunks = numChunks;
+        chunksDone = 0;
+        for(int i=0; i<numThreads; i++){
+            queues[i].next = (numChunks * i) / numThreads;
+            queues[i].end = (numChunks * (i + 1)) / numThreads;
+        }
+
+        /* Wake everyone up */
+        generation++;
+        busyWorkers = numThreads - 1;
+    }
+    wake.notify_all();
+
+    /* Help out on this thread */
+    runChunks(0);
+
+    /* Wait until every chunk is done and no thread is still looking at this job */
+    std::unique_lock<std::mutex> lock(mutex);
+    while(chunksDone < jobNumChunks || busyWorkers > 0){
+        finished.wait(lock);
+    }
+    job = NULL;
+}
+
+//--------------------------------------------------------------
+/* Run chunks from our own queue first, then steal from the others */
+void WorkerPool::runChunks(int worker){
+    for(int n=0; n<numThreads; n++){
+        ChunkQueue &queue = queues[(worker + n) % numThreads];
+        while(true){
+            int c = queue.next.fetch_add(1);
+            if(c >= queue.end)
+            {
+                break;
+            }
+            (*job)(c * jobChunkSize, MIN(jobCount, (c + 1) * jobChunkSize), c);
+            chunksDone++;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void WorkerPool::workerLoop(int worker, unsigned int seenGeneration){
+
+    while(true){
+        {
+            /* Sleep until there is a new job or we are told to stop */
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!stopping && generation == seenGeneration){
+                wake.wait(lock);
+            }
+            if(stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runChunks(worker);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            busyWorkers--;
+        }
+        finished.notify_one();
+    }
+}
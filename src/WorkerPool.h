@@ -0,0 +1,73 @@
+//
+//  WorkerPool.h
+//
+//
+
+/* -This is a pool of threads that stay alive for the whole program and are woken up
+ *  whenever there is work to do, so we don't pay for creating threads every frame.
+ *
+ * -parallelFor() splits a range into chunks. Each thread starts on its own share of the
+ *  chunks and when it runs out it steals chunks from the other threads, so a thread that
+ *  got easy chunks (lots of attached particles) helps the ones that got hard ones.
+ *
+ * -The calling thread works too and parallelFor() only returns once every chunk is done.
+ */
+
+#pragma once
+
+/* Includes */
+#include "ofMain.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+class WorkerPool {
+
+public:
+
+    /* A job gets the range of items to work on and the index of the chunk */
+    typedef function<void(int begin, int end, int chunk)> Job;
+
+    WorkerPool();
+    ~WorkerPool();
+
+    /* Start the threads, zero means one per core */
+    void setup(int _numThreads = 0);
+    void stop();
+
+    /* Run job over 0 to count in chunks of chunkSize, returns when everything is done */
+    void parallelFor(int count, int chunkSize, const Job &job);
+
+    /* How many chunks parallelFor will split count into, useful for sizing per-chunk results */
+    static int getNumChunks(int count, int chunkSize);
+    int getNumThreads();
+
+private:
+
+    /* Each thread owns a range of chunks, padded so two threads never share a cache line */
+    struct ChunkQueue {
+        std::atomic<int> next;
+        int end;
+        char padding[64 - sizeof(std::atomic<int>) - sizeof(int)];
+    };
+
+    void workerLoop(int worker, unsigned int seenGeneration);
+    void runChunks(int worker);
+
+    vector<std::thread> threads;
+    ChunkQueue *queues;
+    int numThreads;
+
+    /* The current job */
+    const Job *job;
+    int jobCount, jobChunkSize, jobNumChunks;
+    std::atomic<int> chunksDone;
+
+    /* Waking the threads up and waiting for them to finish */
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    unsigned int generation;
+    int busyWorkers;
+    bool stopping;
+};
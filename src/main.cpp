@@ -1,8 +1,21 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "PhysicsBenchmark.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+
+    /* With --bench we just time the physics and quit, no window or webcam needed */
+    for(int i=1; i<argc; i++){
+        if(string(argv[i]) == "--bench")
+        {
+            PhysicsBenchmark benchmark;
+            benchmark.parseArguments(argc, argv);
+            benchmark.run();
+            return 0;
+        }
+    }
+
     ofSetupOpenGL(960,720,OF_WINDOW);			// <-------- setup the GL context
 
     // this kicks off the running of my app
@@ -22,44 +22,63 @@
 //--------------------------------------------------------------
 void ofApp::setup(){
     
+    /* Load the settings for this installation */
+    config.load("settings.txt");
+    
     /* General setup */
-    ofSetWindowShape(960, 720);
+    ofSetWindowShape(config.windowWidth, config.windowHeight);
     ofSetVerticalSync(true);
     ofBackground(0);
     
-    /* Set the mesh draw mode to points */
-    sceneMesh.setMode(OF_PRIMITIVE_POINTS);
-
     /* Set the size of the points */
     glPointSize(3);
     
-    /* Variables for drawing a grid */
-    float gridSize = 120;
-    float xStep = ofGetWidth() / gridSize;
-    float yStep = ofGetHeight() / gridSize;
-    float offSetX = xStep / 2;
-    float offSetY = yStep / 2;
-    float radius = 1;
-    
-    /* Nested loop for creating my objects in a grid */
-    for(int i=0; i<gridSize; i++){
-        for(int j=0; j<gridSize; j++){
-            /* Vector to store points and then calculate the positions */
-            ofVec2f p;
-            p.x = xStep * i + offSetX;
-            p.y = yStep * j + offSetY;
-
-            /* Add an element to the particles vector, we use new when its a vector of pointers */
-            myParticles.push_back(new Particle(p, ofColor(255), radius));
-
-            /* Get the position of that particle and add it to the mesh and add a color */
-            sceneMesh.addVertex(myParticles[i * gridSize + j]->getPosition());
-            sceneMesh.addColor(ofColor(0, 0, 0, 255));
-        }
+    /* Start a thread for every core to update the particles on */
+    pool.setup();
+
+    /* Make the grid of particles, they bounce off the edges of the window */
+    simulation.setup(ofGetWidth(), ofGetHeight(), config.gridSize, &pool);
+    simulation.setRepulsion(config.repulsionRadius, config.repulsionStrength);
+    simulation.setSleep(config.tileSleepSpeed, config.tileWakeFlow);
+    simulation.setTimestep(config.physicsSubsteps, config.physicsIntegrator);
+    simulation.particles.springStiffness = config.springStiffness;
+    simulation.setNetwork(config.springNetworkStiffness);
+    simulation.flowSampling = FlowField::getSampling(config.flowSampling);
+
+    /* Carry on from the last snapshot if there is one, then keep saving it */
+    if(!config.snapshotFile.empty())
+    {
+        Checkpointer::load(simulation, ofToDataPath(config.snapshotFile));
+        checkpointer.setup(ofToDataPath(config.snapshotFile), config.checkpointSeconds);
+    }
+
+    /* A thread for each webcam, each one looks at an equal strip of the window. The size the flow
+     * is calculated at has to be set before the renderer takes the image size from the threads
+     */
+    int numCameras = config.cameras.size();
+    for(int c=0; c<numCameras; c++){
+        threads.push_back(unique_ptr<openCvThread>(new openCvThread()));
+        threads[c]->setCamera(config.cameras[c], ofGetWidth() / numCameras, ofGetHeight());
+        threads[c]->setDecimate(config.flowDecimate);
+    }
+    openCvThread &first = *threads[0];
+    if(numCameras > 1)
+    {
+        mosaic.setup(numCameras, first.flowW, first.flowH, first.decimate);
     }
 
-    /* Calculate 50% of the total number of particles */
-    resetPercent = myParticles.size() * 0.5;
+    /* Play a recording instead of the camera if there is one, the image comes from it too */
+    replaying = !config.replayFile.empty() && player.load(ofToDataPath(config.replayFile));
+
+    /* Make a vertex buffer for drawing the particles */
+    if(replaying)
+    {
+        renderer.setup(simulation.particles, player.width, player.height, player.scale);
+    }
+    else
+    {
+        renderer.setup(simulation.particles, first.flowW * numCameras, first.flowH, first.decimate);
+    }
     
     /* Allocate some space for my fbo and clear it of junk, this is to draw my scene in */
     scene.allocate(ofGetWidth(), ofGetHeight(), GL_RGB);
@@ -67,17 +86,38 @@ void ofApp::setup(){
     ofClear(0,0,0);
     scene.end();
 
-    /* Allocating space for ofPixels object, this has to be the same size as the optical Flow image,
-     * seems to throw a warning if I don't allocate space and set the channels first
-    */
-    camPix.allocate(ofGetWidth()*0.25, ofGetHeight()*0.25, OF_PIXELS_RGB);
-    
-    /* By default readFlowField and resetParticles is set to false */
+    /* By default readFlowField is set to false, nothing has come from the thread yet */
     readFlowField = false;
-    resetParticles = false;
+    flowFrame = NULL;
+    showProfiler = false;
+
+    /* Pick the optical flow backend and motion gate from the settings, then start my custom threads */
+    for(int c=0; c<numCameras; c++){
+        threads[c]->setFlowBackend(config.flowBackend);
+        threads[c]->setMotionGate(config.motionIdleThreshold, config.motionLowResThreshold, config.flowDecay);
+        threads[c]->setPollInterval(config.capturePollMillis);
+        threads[c]->setPipelineDepth(config.pipelineDepth);
+    }
 
-    /* Start my custom thread */
-    thread.startThread();
+    /* The cameras aren't needed while replaying */
+    if(!replaying)
+    {
+        /* A recording holds one camera's frames, so it only works with one camera */
+        if(!config.recordFile.empty())
+        {
+            if(numCameras == 1)
+            {
+                first.startRecording(ofToDataPath(config.recordFile));
+            }
+            else
+            {
+                ofLogWarning("ofApp") << "Recording only works with one camera, not recording";
+            }
+        }
+        for(int c=0; c<numCameras; c++){
+            threads[c]->start();
+        }
+    }
 
 }
 
@@ -87,128 +127,74 @@ void ofApp::update(){
     ////////////////////////////////////////////////////////////
     // Seperate Thread Start
 
-    /* Lock */
-    thread.lock();
-    
-    /* Set isNew to true */
-    thread.isNew = true;
-    
-    /* If the flow has been caculated in the thread */
-    if (thread.calculatedFlow)
+    /* Swap in the newest frame the threads have finished, this never blocks. If there is nothing
+     * new we just keep using the last frame
+     */
+    uint64_t fetchStart = ofGetElapsedTimeMicros();
+    bool newFrame = false;
+    if(replaying)
     {
-        /* Set some variables in the the main thread from my thread */
-        w = thread.gray1.width; // Width
-        h = thread.gray1.height; // Height
-        
-        /* Get the optical flow from my thread */
-        flowXPixels = thread.flowX.getPixelsAsFloats();
-        flowYPixels = thread.flowY.getPixelsAsFloats();
-        
-        /* Store the webcam image in an ofPixels */
-        camPix = thread.camImage;
-        
+        /* The recording plays in real time, its frames point straight into the file */
+        newFrame = player.update(ofGetLastFrameTime());
+        flowFrame = &player.frame;
+    }
+    else if(threads.size() == 1)
+    {
+        /* Get the optical flow from my thread, this stays valid until the next fetch */
+        if(threads[0]->flowFrames.fetch())
+        {
+            flowFrame = &threads[0]->flowFrames.getReadBuffer();
+            newFrame = true;
+        }
+    }
+    else
+    {
+        /* Copy each camera that has something new into its strip, the rest keep their last frame */
+        for(size_t c=0; c<threads.size(); c++){
+            if(threads[c]->flowFrames.fetch())
+            {
+                mosaic.setTile(c, threads[c]->flowFrames.getReadBuffer());
+                newFrame = true;
+            }
+        }
+        flowFrame = &mosaic.frame;
+    }
+
+    if(newFrame)
+    {
+        /* Upload the webcam image, the particles look their color up in it on the graphics card */
+        renderer.setImage(flowFrame->image);
+
         /* Set readFlowField to true */
         readFlowField = true;
-
     }
-    
-    /* Unlock */
-    thread.unlock();
+    Profiler::get().record(Profiler::FLOW_FETCH, fetchStart, ofGetElapsedTimeMicros());
 
     // Seperate Thread End
     ////////////////////////////////////////////////////////////
     
     
 
-    /* Variable to store how many particles are disconnected from there spring */
-    int freeParticleCount = 0;
-  
-    /* Only read from flowPixels arrays if they have something added to them, basically im waiting 
-     * for the other thread to calculate something otherwise im reading from an empty array and that
-     * is not good!
+    /* Only read from the flow frame if it has something in it, basically im waiting for the other
+     * thread to calculate something otherwise im reading from an empty array and that is not good!
      */
     if(readFlowField)
     {
         ////////////////////////////////////////////////////////////
         // Update Particles Start
 
-        /* Loop over the particles array */
-        for(int i=0; i<myParticles.size(); i++){
-            
-            /* Reset the force each frame */
-            myParticles[i]->resetForce();
-            
-            /* Scale the particle positions to equal the optical flow dimensions, very important! */
-            ofVec2f p = myParticles[i]->getPosition() * 0.25;
-            
-            /* Variable for storing the force to apply */
-            ofVec2f f;
-
-            /* Set the default force to nothing */
-            f.set(0,0);
-            
-            /* Convert the particle position to an int so we can use it to read from an array */
-            int fieldPosX = (int)p.x;
-            int fieldPosY = (int)p.y;
-            
-            /* This is for safety, just to make sure we don't step outside the array at any point */
-            fieldPosX = MAX(0, MIN(fieldPosX, w-1));
-            fieldPosY = MAX(0, MIN(fieldPosY, h-1));
-            
-            /* Get the position in the array */
-            int pos = fieldPosY * w + fieldPosX;
-
-            /* Read the value from the arrays and reverse the direction */
-            f.set(flowXPixels[pos] * -1, flowYPixels[pos] * -1);
-            
-            /* Add a global force to the particles, eg. Gravity */
-            myParticles[i]->addForce(ofVec2f(0, 0.004));
-
-            /* Add the force from the optical flow */
-            myParticles[i]->addCvForce(f);
-            
-            /* Dampen the force */
-            myParticles[i]->dampenForce();
-            
-            /* Update the particle */
-            myParticles[i]->update();
-
-            /* Here I am counting how many particles are free from the spring */
-            if(myParticles[i]->getIsFree())
-            {
-                freeParticleCount++;
-
-                /* If the value is over a certian percentage then it sets a varibale to true */
-                if(freeParticleCount > resetPercent)
-                {
-                    resetParticles = true;
-                }
-                else if(freeParticleCount == 0)
-                {
-                    /* Pick a random reset percentage, this adds slight variation */
-                    resetPercent = myParticles.size() * ofRandom(0.3, 0.7);
-
-                    /* If the total number is zero it sets that variable to false */
-                    resetParticles = false;
-                }
-            }
-        }
-
-        /* Loop through the particles again, so that I can call every particles resetPosition function,
-         * not just the ones above freeParticleCount
+        /* Read the flow, update every particle and reset them if too many are free. This runs
+         * however many fixed ticks fit into the time since the last frame, which can be none
          */
+        uint64_t physicsStart = ofGetElapsedTimeMicros();
+        int ticks = simulation.advance(*flowFrame, ofGetLastFrameTime());
 
-        for(int i=0; i<myParticles.size(); i++){
+        /* A recording's timestamps aren't from this clock, so there is no latency to measure */
+        uint64_t captureTime = newFrame && !replaying ? flowFrame->timestamp : 0;
+        PipelineStats::get().record(PipelineStats::PHYSICS, physicsStart, ofGetElapsedTimeMicros(), captureTime);
 
-            /* If the particle is currently free from its spring and the global reset to true then
-             * run the reset function
-             */
-
-            if(myParticles[i]->getIsFree() == true && resetParticles == true)
-            {
-                myParticles[i]->resetPosition();
-            }
-        }
+        /* Only copies the arrays when a checkpoint is due, a thread writes them to disk */
+        checkpointer.update(simulation);
 
         // Update Particles End
         ////////////////////////////////////////////////////////////
@@ -216,31 +202,16 @@ void ofApp::update(){
 
 
         ////////////////////////////////////////////////////////////
-        // Update Mesh Start
+        // Update Vertex Buffer Start
         
-        /* Loop over the mesh */
-        for(int i=0; i<sceneMesh.getNumVertices(); i++){
-            
-            /* Get the vertex at a specific index */
-            ofVec3f p = sceneMesh.getVertex(i);
-            
-            /* Update that vertex with the corresponding position from myParticles */
-            p = myParticles[i]->getPosition();
-            
-            /* Set the vertex at the current index with the new position */
-            sceneMesh.setVertex(i, p);
-            
-            /* Get the origin point of the particle */
-            ofVec2f o = myParticles[i]->getOrigin();
-            
-            /* Get the color of the pixel relative to the origin point from the webcam image that is store in an ofPixels */
-            ofColor col = camPix.getColor((int)o.x, (int)o.y);
-            
-            /* Update the color in the mesh for this vertex */
-            sceneMesh.setColor(i, col);
-        }
+        /* Upload the positions straight from the particle system if a tick moved them. The shader
+         * blends them between the last two ticks so the motion is smooth when the frame rate isn't 60
+         */
+        uint64_t meshStart = ofGetElapsedTimeMicros();
+        renderer.update(simulation.particles, simulation.clock.getAlpha(), ticks > 0);
+        Profiler::get().record(Profiler::MESH_UPDATE, meshStart, ofGetElapsedTimeMicros());
 
-        // Update Mesh End
+        // Update Vertex Buffer End
         ////////////////////////////////////////////////////////////
 
     }
@@ -249,16 +220,23 @@ void ofApp::update(){
     // Scene Fbo Start
     
     /* Draw to an Fbo */
+    uint64_t fboStart = ofGetElapsedTimeMicros();
     scene.begin();
     
     /* Clear the fbo each frame */
     ofClear(0, 0, 0);
     
-    /* Draw the mesh into the fbo */
-    sceneMesh.draw();
+    /* Draw the particles into the fbo */
+    renderer.draw();
     
     /* Close the fbo */
     scene.end();
+    uint64_t fboEnd = ofGetElapsedTimeMicros();
+    Profiler::get().record(Profiler::FBO_DRAW, fboStart, fboEnd);
+
+    /* The drawing is only queued here, the graphics card does it while the next frame's physics runs */
+    PipelineStats::get().record(PipelineStats::RENDER, fboStart, fboEnd, newFrame && !replaying ? flowFrame->timestamp : 0);
+    PipelineStats::get().update();
     
     // Scene Fbo End
     ////////////////////////////////////////////////////////////
@@ -272,20 +250,61 @@ void ofApp::draw(){
     ofSetColor(255, 255, 255);
     scene.draw(0,0);
 
-//    /* For debugging FrameRate and Amount of Particles */
-//    ofSetColor(255, 0, 0);
-//    ofDrawBitmapString("FrameRate: " + ofToString(ofGetFrameRate()), 10, 10);
-//    ofDrawBitmapString("NumParticles: " + ofToString(myParticles.size()), 10, 20);
+    /* Timings of the last second, for finding out why an installation is dropping frames */
+    if(showProfiler)
+    {
+        Profiler::get().drawOverlay(10, 10);
+        float y = 10 + (Profiler::NUM_STAGES + PipelineStats::NUM_STAGES + 3) * 12;
+
+        /* What used to be the debug lines, once per camera */
+        ofSetColor(255, 0, 0);
+        ofDrawBitmapString("NumParticles: " + ofToString(simulation.particles.size()), 10, y);
+        for(size_t c=0; c<threads.size(); c++){
+            ofDrawBitmapString("Camera " + ofToString(c) + ": flow " + ofToString(threads[c]->getFlowMillis(), 1) + " ms, "
+                               + ofToString(threads[c]->getSkippedFrames()) + " skipped, " + ofToString(threads[c]->getLowResFrames()) + " low res, "
+                               + ofToString(threads[c]->getFrameAllocations()) + " allocations", 10, y + (c + 1) * 12);
+        }
+        ofSetColor(255);
+    }
     
-    /* Once drawn then calculate the next frame of the optical flow */
-    thread.lock();
-    thread.drawn=true;
-    thread.unlock();
-
 }
 
 //--------------------------------------------------------------
-// Stop the thread when exiting the application
+// Stop the threads when exiting the application
 void ofApp::exit(){
-    thread.stopThread();
+    for(size_t c=0; c<threads.size(); c++){
+        threads[c]->stop();
+    }
+    pool.stop();
+
+    /* One last checkpoint if they are on, after the one that may still be writing */
+    if(config.checkpointSeconds > 0 && !checkpointer.checkpointAndWait(simulation))
+    {
+        ofLogError("ofApp") << "Could not save the last checkpoint";
+    }
+    checkpointer.stop();
+}
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key){
+
+    /* 'p' shows the timings, 'c' and 't' save them as CSV or a Chrome trace to the data folder,
+     * 's' saves a snapshot of the simulation
+     */
+    if(key == 'p')
+    {
+        showProfiler = !showProfiler;
+    }
+    else if(key == 'c')
+    {
+        Profiler::get().saveCsv("profile-" + ofGetTimestampString() + ".csv");
+    }
+    else if(key == 't')
+    {
+        Profiler::get().saveChromeTrace("trace-" + ofGetTimestampString() + ".json");
+    }
+    else if(key == 's')
+    {
+        checkpointer.checkpoint(simulation);
+    }
 }
@@ -3,7 +3,14 @@
 /* Includes */
 #include "ofMain.h"
 #include "openCvThread.h"
-#include "Particle.h"
+#include "FlowMosaic.h"
+#include "AppConfig.h"
+#include "Simulation.h"
+#include "ParticleRenderer.h"
+#include "Profiler.h"
+#include "FlowPlayer.h"
+#include "PipelineStats.h"
+#include "Checkpointer.h"
 
 class ofApp : public ofBaseApp{
 
@@ -14,27 +21,41 @@ public:
     void update();
     void draw();
     void exit();
+    void keyPressed(int key);
     
-    /* Create an instance of my thread which does the OpenCV calculations */
-    openCvThread thread;
+    /* Settings for this installation, loaded from the data folder */
+    AppConfig config;
     
-    /* Fbo to draw my scene to and ofPixels to store webcam data */
+    /* One of my threads for each webcam, they do the OpenCV calculations */
+    vector<unique_ptr<openCvThread>> threads;
+
+    /* With more than one webcam their flow is put side by side into one frame */
+    FlowMosaic mosaic;
+    
+    /* Fbo to draw my scene to */
     ofFbo scene;
-    ofPixels camPix;
     
-    /* A mesh to draw my points, this is way faster than using 'ofDrawCircle()' */
-    ofMesh sceneMesh;
+    /* Draws my points from a vertex buffer, this is way faster than using 'ofDrawCircle()' or an ofMesh */
+    ParticleRenderer renderer;
+    
+    /* Plays a recording instead of using the camera, when the settings ask for one */
+    FlowPlayer player;
+    bool replaying;
     
-    //Optical flow
-    float *flowXPixels;
-    float *flowYPixels;
-    int w, h;
+    /* The latest optical flow frame from my thread or the recording */
+    FlowFrame *flowFrame;
     
-    /* Vector of pointers */
-    vector<Particle*> myParticles;
+    /* The particles and the physics, and the threads that update them */
+    Simulation simulation;
+    WorkerPool pool;
+
+    /* Saves the simulation now and then, so a crash can carry on where it was */
+    Checkpointer checkpointer;
 
     /* Boolean to tell my program when to read the optical flow */
-    bool readFlowField, resetParticles;
-    int resetPercent;
+    bool readFlowField;
+
+    /* Show how long each part of the frame takes, toggled with 'p' */
+    bool showProfiler;
 
 };
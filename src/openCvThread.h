@@ -9,6 +9,31 @@
  *  using a seperate thread and is more effiecent as it will not get in the way
  *  of drawing my scene but freeing up cpu in the main thread.
  *
+ * -How the flow is calculated is up to the FlowEstimator, set from the settings file
+ *  before the thread starts.
+ *
+ * -When nothing is moving in front of the camera, which is most of the night, the flow
+ *  is not calculated at all and the last flow just fades out. With only a little motion
+ *  it is calculated at half the size. A frame difference decides which, it is much
+ *  cheaper than the flow itself.
+ *
+ * -Finished frames are handed to the main thread through a triple buffer, so neither
+ *  thread ever waits for the other or has to take a lock.
+ *
+ * -Every published frame can also be recorded to a file and played back later with
+ *  FlowPlayer, see FlowRecording.h.
+ *
+ * -The work is split over two threads so they overlap. The capture thread takes a frame off
+ *  the camera, mirrors and shrinks it into a slot of a bounded queue in one pass over the
+ *  camera's pixels (see FrameConverter.h), while the flow thread
+ *  calculates the flow of the frame before and publishes it. The main thread runs the physics
+ *  on the flow before that and the graphics card draws the one before that again. The depth
+ *  of the queue is how far capture can get ahead of the flow, see FrameQueue.h.
+ *
+ * -ofVideoGrabber can't tell us when a frame arrives, so between frames the capture thread
+ *  waits on a condition variable and checks the camera every few milliseconds instead of
+ *  spinning on a core. The flow thread sleeps on the queue until there is a frame.
+ *
  * -Optical Flow with minor adjustments, taken from the 'Camera Controller' example
  *  from 'Term 2 of Workshops in Creative Coding'.
  */
@@ -19,6 +44,19 @@
 #include "ofMain.h"
 #include "ofThread.h"
 #include "ofxOpenCV.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "TripleBuffer.h"
+#include "FrameQueue.h"
+#include "FlowFrame.h"
+#include "FlowEstimator.h"
+#include "Profiler.h"
+#include "PipelineStats.h"
+#include "FlowRecorder.h"
+#include "FrameConverter.h"
 
 /* Set namespace to cv */
 using namespace cv;
@@ -28,102 +66,557 @@ class openCvThread : public ofThread {
     
 public:
     
-    bool drawn;
+    /* The steps each frame goes through, the capture thread does capture and convert and the
+     * flow thread does flow and publish. WAITING is between frames
+     */
+    enum State {
+        WAITING,
+        CAPTURE,
+        CONVERT,
+        FLOW,
+        PUBLISH
+    };
+    
+    /* A shrunk camera frame on its way from the capture thread to the flow thread */
+    struct CapturedFrame {
+        ofxCvColorImage color;
+        ofxCvGrayscaleImage gray;
+        uint64_t captureTime;
+    };
     
     /* Create a video grabber */
     ofVideoGrabber cam;
-    ofPixels camImage;
     
-    bool isNew, calculatedFlow;
     float decimate; // Decimate is global
+    int camW, camH; // Size of the webcam frames
+    int deviceId; // Which webcam, opened when the threads start
+    int flowW, flowH; // Size of everything after decimating
+    unsigned long long frameCount;
+
+    /* The frames handed over to the main thread, this thread only ever writes to the write buffer */
+    TripleBuffer<FlowFrame> flowFrames;
+    
+    FrameConverter converter;			//Shrinks the webcam frames, only used by the capture thread
+    FrameQueue<CapturedFrame> captured;	//Decimated frames waiting for the flow thread
+    ofxCvGrayscaleImage gray2;			//The last frame the flow was calculated from
+    Mat flow;							//Two channel flow image, reused every frame
+    FlowEstimator *estimator;			//Calculates the flow, Farneback unless the settings say otherwise
     
-    ofxCvColorImage currentColor;		//First and second original images
-    ofxCvGrayscaleImage gray1, gray2;	//Decimated grayscaled images
-    ofxCvFloatImage flowX, flowY;		//Resulted optical flow in x and y axes
+    /* Motion gate, the thresholds are the mean pixel difference between frames on a 0-255 scale */
+    Mat motionDiff;						//Difference between the new frame and gray2, reused every frame
+    Mat small1, small2, smallFlow;		//Half size images for when there is only a little motion
+    FlowEstimator *smallEstimator;		//The same backend set up for the half size images
+    float idleThreshold, lowResThreshold, flowDecay;
+    float motionEnergy;
+    std::atomic<unsigned int> skippedFrames, lowResFrames, fullResFrames;
+    
+    /* Counts every time one of the buffers above had to be allocated after the constructor,
+     * this should stay at zero while the camera is running
+     */
+    std::atomic<unsigned int> frameAllocations;
+    
+    /* Where each thread is, and what the capture thread waits on between camera frames */
+    std::thread captureThread;
+    std::atomic<State> captureState, flowState;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool wakeRequested;
+    int pollMillis;
+    std::atomic<unsigned int> idlePolls;
+    uint64_t captureStart, flowStart;
+    
+    /* How many times the capture thread found every slot full and had to wait for the flow */
+    std::atomic<unsigned int> captureStalls;
+    
+    /* Writes every published frame to a file when recording */
+    FlowRecorder recorder;
     
     //--------------------------------------------------------------
     openCvThread() {
         
-        drawn = false;
+        /* Variables for width and height, the first webcam at the window size unless setCamera says otherwise */
+        camW = ofGetWidth();
+        camH = ofGetHeight();
+        deviceId = 0;
+        
+        /* No frames have been published yet */
+        frameCount = 0;
+        frameAllocations = 0;
+        
+        /* A 30fps camera gets checked about 8 times per frame */
+        captureState = WAITING;
+        flowState = WAITING;
+        wakeRequested = false;
+        pollMillis = 4;
+        idlePolls = 0;
+        captureStart = 0;
+        flowStart = 0;
+        captureStalls = 0;
+        
+        /* The motion gate is off until setMotionGate is called */
+        idleThreshold = 0;
+        lowResThreshold = 0;
+        flowDecay = 0.9;
+        motionEnergy = 0;
+        skippedFrames = 0;
+        lowResFrames = 0;
+        fullResFrames = 0;
+        
+        /* Allocate everything at a quarter of the webcam size */
+        estimator = NULL;
+        smallEstimator = NULL;
+        setDecimate(0.25);
         
-        /* Variables for width, height and decimate */
-        int camW = ofGetWidth();
-        int camH = ofGetHeight();
-        decimate = 0.25;
+        /* Use Farneback by default */
+        setFlowBackend("farneback");
+    }
+    
+    //--------------------------------------------------------------
+    ~openCvThread() {
+        delete estimator;
+        delete smallEstimator;
+    }
+    
+    //--------------------------------------------------------------
+    /* Which webcam to use and the size to ask it for, which should be the size of the part of the
+     * screen it covers. This allocates every buffer again, so only call it before the thread is started
+     */
+    void setCamera(int _deviceId, int width, int height) {
+        deviceId = _deviceId;
+        camW = width;
+        camH = height;
+        setDecimate(decimate);
+    }
+    
+    //--------------------------------------------------------------
+    /* How much smaller than the webcam the flow is calculated, this allocates every buffer again
+     * so only call it before the thread is started
+     */
+    void setDecimate(float _decimate) {
+        decimate = _decimate;
+        flowW = MAX(2, (int)(camW * decimate));
+        flowH = MAX(2, (int)(camH * decimate));
+        
+        /* Seperate threads to the main one cannot use OpenGl, so we disable the use of textures which will turn off all GL calls.
+         * We allocate the right amount of space, so we know these will be smaller so we use the decimate varibale.
+         * Every slot of the queue is allocated so the depth can be changed without doing this again
+         */
+        for(int i=0; i<FrameQueue<CapturedFrame>::MAX_DEPTH; i++){
+            CapturedFrame &slot = captured.getSlot(i);
+            slot.color.setUseTexture(false);
+            slot.color.allocate(flowW, flowH);
+            slot.gray.setUseTexture(false);
+            slot.gray.allocate(flowW, flowH);
+            slot.captureTime = 0;
+        }
+        gray2.setUseTexture(false);
+        gray2.allocate(flowW, flowH);
+        flow.create(flowH, flowW, CV_32FC2);
+        flow.setTo(Scalar::all(0));
+        motionDiff.create(flowH, flowW, CV_8UC1);
+        small1.create((flowH + 1) / 2, (flowW + 1) / 2, CV_8UC1);
+        small2.create((flowH + 1) / 2, (flowW + 1) / 2, CV_8UC1);
+        smallFlow.create((flowH + 1) / 2, (flowW + 1) / 2, CV_32FC2);
+        
+        /* Allocate all three frames up front, after this the thread only ever writes into them */
+        for(int i=0; i<3; i++){
+            FlowFrame &frame = flowFrames.getBuffer(i);
+            frame.field.allocate(flowW, flowH, decimate);
+            frame.image.allocate(flowW, flowH, OF_PIXELS_RGB);
+        }
+        
+        /* The flow backend was set up for the old size */
+        if(estimator != NULL)
+        {
+            setFlowBackend(estimator->getName());
+        }
+    }
+    
+    //--------------------------------------------------------------
+    /* Pick how the flow is calculated, only call this before the thread is started */
+    void setFlowBackend(string name) {
+        delete estimator;
+        estimator = FlowEstimator::create(name);
+        estimator->setup(flowW, flowH);
+        delete smallEstimator;
+        smallEstimator = FlowEstimator::create(name);
+        smallEstimator->setup(smallFlow.cols, smallFlow.rows);
+        ofLogNotice("openCvThread") << "Optical flow backend: " << estimator->getName();
+    }
+    
+    //--------------------------------------------------------------
+    /* Below idle the flow is skipped, below lowRes it runs at half size, only call this before the thread is started */
+    void setMotionGate(float _idleThreshold, float _lowResThreshold, float _flowDecay) {
+        idleThreshold = _idleThreshold;
+        lowResThreshold = _lowResThreshold;
+        flowDecay = _flowDecay;
+    }
+    
+    //--------------------------------------------------------------
+    /* Counters for the motion gate */
+    unsigned int getSkippedFrames() {
+        return skippedFrames;
+    }
+    
+    unsigned int getLowResFrames() {
+        return lowResFrames;
+    }
+    
+    unsigned int getFullResFrames() {
+        return fullResFrames;
+    }
+    
+    //--------------------------------------------------------------
+    /* How long the flow took to calculate, averaged over the last few frames */
+    float getFlowMillis() {
+        return estimator->getAverageMillis();
+    }
+    
+    //--------------------------------------------------------------
+    /* How many times a buffer was allocated while running, zero means the steady state is allocation free */
+    unsigned int getFrameAllocations() {
+        return frameAllocations;
+    }
+    
+    //--------------------------------------------------------------
+    /* How long to wait between checking the camera when there was no new frame */
+    void setPollInterval(int millis) {
+        pollMillis = MAX(1, millis);
+    }
+    
+    //--------------------------------------------------------------
+    /* How many shrunk frames can wait for the flow, one means capture and flow take turns. Only
+     * call this before the thread is started
+     */
+    void setPipelineDepth(int depth) {
+        captured.setDepth(depth);
+    }
+    
+    //--------------------------------------------------------------
+    /* Record every frame this thread publishes to path, only call this before the thread is started */
+    bool startRecording(string path) {
+        return recorder.open(path, flowW, flowH, decimate);
+    }
+    
+    //--------------------------------------------------------------
+    /* Open the webcam, then start the flow thread and the capture thread that feeds it */
+    void start() {
         
         /* Setup webcam and dont use texture */
         //cam.setDesiredFrameRate(60);
+        cam.setDeviceID(deviceId);
         cam.initGrabber(camW, camH);
         cam.setUseTexture(false);
         
-        /* By default the flow has not been calcuated */
-        calculatedFlow = false;
+        /* The camera may not give us the size we asked for */
+        converter.setup(cam.getWidth(), cam.getHeight(), flowW, flowH);
+        if(converter.srcW > 0 && converter.srcH > 0)
+        {
+            /* It should be exactly what OpenCV gives when the camera is a whole number of times bigger */
+            bool exact = converter.srcW % flowW == 0 && converter.srcH % flowH == 0;
+            double converterError = validateConverter();
+            ofLogNotice("openCvThread") << "Frame converter: max difference against OpenCV: " << converterError;
+            if(exact && converterError > 0)
+            {
+                ofLogWarning("openCvThread") << "Frame converter doesn't match OpenCV at a whole number scale";
+            }
+        }
+        
+        startThread();
+        captureThread = std::thread([this]{ captureLoop(); });
+    }
+    
+    //--------------------------------------------------------------
+    /* Shrink a made up camera frame with the converter and the way this thread used to do it, a
+     * mirror, an area resize and a gray conversion in OpenCV, and return the biggest difference in
+     * either image
+     */
+    double validateConverter() {
+        Mat frame(converter.srcH, converter.srcW, CV_8UC3);
+        for(int y=0; y<frame.rows; y++){
+            unsigned char *row = frame.ptr<unsigned char>(y);
+            for(int x=0; x<frame.cols; x++){
+                row[x * 3] = x * 7 + y * 13;
+                row[x * 3 + 1] = x * 3 + ((x * y) & 31);
+                row[x * 3 + 2] = 255 - y * 5 + (x & 7);
+            }
+        }
         
-        /* Seperate threads to the main one cannot use OpenGl, so we disable the use of textures which will turn off all GL calls */
-        currentColor.setUseTexture(false);
+        Mat color(flowH, flowW, CV_8UC3);
+        Mat gray(flowH, flowW, CV_8UC1);
+        converter.convert(frame.data, 3, color.data, color.step, gray.data, gray.step);
         
-        /* Then we allocate space, if you do not allocate space, the program will crash */
-        currentColor.allocate(camW, camH);
+        Mat mirrored, expectedColor, expectedGray;
+        flip(frame, mirrored, 1);
+        resize(mirrored, expectedColor, Size(flowW, flowH), 0, 0, INTER_AREA);
+        cvtColor(expectedColor, expectedGray, COLOR_RGB2GRAY);
+        return MAX(norm(color, expectedColor, NORM_INF), norm(gray, expectedGray, NORM_INF));
+    }
+    
+    //--------------------------------------------------------------
+    /* Stop both threads and wake them up if they are waiting, so they don't finish their wait first */
+    void stop() {
+        stopThread();
+        captured.interrupt();
+        wake();
+        waitForThread(false);
+        if(captureThread.joinable())
+        {
+            captureThread.join();
+        }
         
-        /* We allocate the right amount of space, so we know these will be smaller so we use the decimate varibale */
-        gray1.setUseTexture(false);
-        gray1.allocate(camW * decimate, camH * decimate);
-        gray2.setUseTexture(false);
-        gray2.allocate(camW * decimate, camH * decimate);
-        flowX.setUseTexture(false);
-        flowX.allocate(camW * decimate, camH * decimate);
-        flowY.setUseTexture(false);
-        flowY.allocate(camW * decimate, camH * decimate);
+        /* The thread is done with the recording, write its index */
+        recorder.close();
+    }
+    
+    //--------------------------------------------------------------
+    /* Wake the capture thread up early, it will check the camera straight away */
+    void wake() {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeRequested = true;
+        wakeCondition.notify_one();
+    }
+    
+    //--------------------------------------------------------------
+    /* What each thread is doing right now, for debugging */
+    State getCaptureState() {
+        return captureState;
+    }
+    
+    State getFlowState() {
+        return flowState;
     }
     
     //--------------------------------------------------------------
+    /* How many times the camera was checked and had nothing new */
+    unsigned int getIdlePolls() {
+        return idlePolls;
+    }
+    
+    /* How many times capture got a whole queue ahead of the flow and had to wait */
+    unsigned int getCaptureStalls() {
+        return captureStalls;
+    }
+    
+    //--------------------------------------------------------------
+    /* The flow thread, sleeps until the capture thread has queued a frame */
     void threadedFunction() {
+        CapturedFrame *frame = NULL;
+        flowState = WAITING;
         while(isThreadRunning()) {
+            switch(flowState) {
+                case WAITING:
+                    /* Time out now and then to see if the thread was stopped */
+                    frame = captured.front(100);
+                    flowState = frame != NULL ? FLOW : WAITING;
+                    break;
+                    
+                case FLOW:
+                    flowStart = ofGetElapsedTimeMicros();
+                    calculateFlow(*frame);
+                    flowState = PUBLISH;
+                    break;
+                    
+                case PUBLISH:
+                    publish(*frame);
+                    
+                    /* The slot can be filled again */
+                    captured.pop();
+                    frame = NULL;
+                    flowState = WAITING;
+                    break;
+                    
+                default:
+                    flowState = WAITING;
+                    break;
+            }
+        }
+    }
+    
+    //--------------------------------------------------------------
+    /* The capture thread, fills the queue as fast as the camera and the flow thread allow */
+    void captureLoop() {
+        CapturedFrame *slot = NULL;
+        captureState = WAITING;
+        while(isThreadRunning()) {
+            switch(captureState) {
+                case WAITING:
+                    waitForWake();
+                    captureState = CAPTURE;
+                    break;
+                    
+                case CAPTURE:
+                    /* Get a slot before looking at the camera, so the frame isn't old by the time there is room for it */
+                    if(slot == NULL)
+                    {
+                        slot = captured.acquire(pollMillis);
+                        if(slot == NULL)
+                        {
+                            captureStalls++;
+                            break;
+                        }
+                    }
+                    
+                    /* Nothing new from the camera, go back to waiting */
+                    captureState = capture() ? CONVERT : WAITING;
+                    break;
+                    
+                case CONVERT:
+                    convert(*slot);
+                    captured.push();
+                    slot = NULL;
+                    
+                    /* Check for the next frame before waiting, the camera may already have one */
+                    captureState = CAPTURE;
+                    break;
+                    
+                default:
+                    captureState = WAITING;
+                    break;
+            }
+        }
+    }
+    
+    //--------------------------------------------------------------
+    /* Sleep until the poll interval is up or someone calls wake(), this is what keeps the thread
+     * from using a whole core while there is no new frame
+     */
+    void waitForWake() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.wait_for(lock, std::chrono::milliseconds(pollMillis), [this]{ return wakeRequested; });
+        wakeRequested = false;
+    }
+    
+    //--------------------------------------------------------------
+    /* Update the webcam pixels, returns false if there was no new frame */
+    bool capture() {
+        uint64_t start = ofGetElapsedTimeMicros();
+        cam.update();
+        
+        if(!cam.isFrameNew())
+        {
+            idlePolls++;
+            return false;
+        }
+        captureStart = start;
+        
+        /* Only frames that were new are timed, otherwise this is just checking the camera */
+        Profiler::get().record(Profiler::CAPTURE, captureStart, ofGetElapsedTimeMicros());
+        return true;
+    }
+    
+    //--------------------------------------------------------------
+    /* Mirror the new frame and shrink it into the slot, reading the grabber's pixels where they are
+     * and writing straight into the slot's images
+     */
+    void convert(CapturedFrame &slot) {
+        {
+            ProfileScope scope(Profiler::CONVERT);
             
-            /* Update the webcam pixels */
-            cam.update();
-            
-            if(cam.isFrameNew() && isNew && drawn)
+            /* Grabbers give RGB unless they are asked for something else */
+            ofPixels &pixels = cam.getPixels();
+            if(!converter.isSetup(pixels.getWidth(), pixels.getHeight(), flowW, flowH))
             {
-                if ( gray1.bAllocated ) {
-                    gray2 = gray1;
-                    calculatedFlow = true;
-                }
-                
-                //Convert to ofxCv images
-                currentColor.setFromPixels(cam.getPixels());
-                
-                /* Flip the image */
-                currentColor.mirror(false, true);
-                
-                /* Save the webcam image in an ofPixels so I can access it outside the thread and draw it */
-                camImage = currentColor.getPixels();
-                
-                ofxCvColorImage imageDecimated1;
-                
-                /* Do not use a texture */
-                imageDecimated1.setUseTexture(false);
-                
-                imageDecimated1.allocate(currentColor.width * decimate, currentColor.height * decimate);
-                imageDecimated1.scaleIntoMe(currentColor, CV_INTER_AREA);             //High-quality resize
-                gray1 = imageDecimated1;
-                
-                if (gray2.bAllocated){
-                    Mat img1(gray1.getCvImage());  //Create OpenCV images
-                    Mat img2(gray2.getCvImage());
-                    Mat flow;                        //Image for flow
-                    //Computing optical flow (visit https://goo.gl/jm1Vfr for explanation of parameters)
-                    calcOpticalFlowFarneback(img1, img2, flow, 0.7, 3, 11, 5, 5, 1.1, 0);
-                    //Split flow into separate images
-                    vector<Mat> flowPlanes;
-                    split(flow, flowPlanes);
-                    //Copy float planes to ofxCv images flowX and flowY
-                    IplImage iplX(flowPlanes[0]);
-                    flowX = &iplX;
-                    IplImage iplY(flowPlanes[1]);
-                    flowY = &iplY;
-                }
+                converter.setup(pixels.getWidth(), pixels.getHeight(), flowW, flowH);
+                countAllocation(true);
             }
+            
+            IplImage *color = slot.color.getCvImage();
+            IplImage *gray = slot.gray.getCvImage();
+            converter.convert(pixels.getData(), pixels.getNumChannels(),
+                              (unsigned char*)color->imageData, color->widthStep,
+                              (unsigned char*)gray->imageData, gray->widthStep);
+            slot.color.flagImageChanged();
+            slot.gray.flagImageChanged();
+        }
+        slot.captureTime = captureStart;
+        PipelineStats::get().record(PipelineStats::CAPTURE, captureStart, ofGetElapsedTimeMicros(), captureStart);
+    }
+    
+    //--------------------------------------------------------------
+    /* Skip, shrink or calculate the flow depending on how much moved */
+    void calculateFlow(CapturedFrame &source) {
+        ProfileScope flowScope(Profiler::FLOW);
+        
+        Mat img1(source.gray.getCvImage());  //Create OpenCV images, these only wrap the existing memory
+        Mat img2(gray2.getCvImage());
+        
+        /* How much changed since the last frame, not needed with the gate off */
+        if(idleThreshold > 0 || lowResThreshold > 0)
+        {
+            absdiff(img1, img2, motionDiff);
+            motionEnergy = mean(motionDiff)[0];
+        }
+        
+        uchar *flowData = flow.data;
+        if(motionEnergy < idleThreshold)
+        {
+            /* Nothing is moving, let the last flow fade out instead of calculating a new one */
+            flow.convertTo(flow, -1, flowDecay);
+            skippedFrames++;
+        }
+        else if(motionEnergy < lowResThreshold)
+        {
+            /* Only a little motion, calculate the flow at half the size and scale it back up,
+             * the vectors are twice as long at full size
+             */
+            pyrDown(img1, small1, small1.size());
+            pyrDown(img2, small2, small2.size());
+            smallEstimator->estimate(small1, small2, smallFlow);
+            resize(smallFlow, flow, flow.size(), 0, 0, INTER_LINEAR);
+            flow.convertTo(flow, -1, 2);
+            lowResFrames++;
+        }
+        else
+        {
+            //Computing optical flow with whichever backend was picked
+            estimator->estimate(img1, img2, flow);
+            fullResFrames++;
+        }
+        countAllocation(flow.data != flowData);
+    }
+    
+    //--------------------------------------------------------------
+    /* Fill the write buffer and hand it to the main thread */
+    void publish(CapturedFrame &source) {
+        
+        /* Split the flow straight into the frame the main thread will read next, the planes
+         * wrap the frame's arrays so split() writes into them without allocating
+         */
+        FlowFrame &frame = flowFrames.getWriteBuffer();
+        Mat flowPlanes[2] = {
+            Mat(flowH, flowW, CV_32F, frame.field.flowX.data()),
+            Mat(flowH, flowW, CV_32F, frame.field.flowY.data())
+        };
+        split(flow, flowPlanes);
+        countAllocation(flowPlanes[0].data != (uchar*)frame.field.flowX.data() || flowPlanes[1].data != (uchar*)frame.field.flowY.data());
+        
+        /* Save the decimated webcam image so I can access it outside the thread and draw it */
+        unsigned char *imageData = frame.image.getData();
+        frame.image.setFromPixels(source.color.getPixels().getData(), flowW, flowH, OF_PIXELS_RGB);
+        countAllocation(frame.image.getData() != imageData);
+        frame.sequence = ++frameCount;
+        frame.timestamp = source.captureTime;
+        
+        /* Write it out before the main thread can get hold of it */
+        if(recorder.isOpen())
+        {
+            recorder.write(frame);
+        }
+        
+        /* Hand it over, this is a single atomic swap */
+        flowFrames.publish();
+        
+        /* The next flow is calculated against this frame, this is a copy into gray2's existing memory */
+        gray2 = source.gray;
+        PipelineStats::get().record(PipelineStats::FLOW, flowStart, ofGetElapsedTimeMicros(), source.captureTime);
+    }
+    
+    //--------------------------------------------------------------
+    void countAllocation(bool allocated) {
+        if(allocated)
+        {
+            frameAllocations++;
         }
     }
 };